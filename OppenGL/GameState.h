@@ -5,11 +5,20 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <vector>
+#include <functional>
 
 #include "shader.h"
+#include "sprite_batch.h"
+#include "render_queue.h"
+#include "camera.h"
+#include "render_thread.h"
+#include "input.h"
+#include "texture_atlas.h"
+#include "animation.h"
 #include "stb_image.h"
 #include "character.h"
 #include "collide.h"
+#include "level_geometry.h"
 #include "enemi.h"
 #include "arm.h"
 #include "crosshair.h"
@@ -20,26 +29,47 @@ class Level2;
 // Base class for all game levels
 class GameLevel {
 protected:
-    GLFWwindow* window;
+    Input& input;
     float lastFrame = 0.0f;
     static GameLevel* currentLevel; // Add static pointer to current level
 
+    // World extents of the level; the camera never shows anything outside them
+    float worldMinX = -1.0f, worldMinY = -1.0f, worldMaxX = 1.0f, worldMaxY = 1.0f;
+    Camera2D camera;
+
+    // Moves the camera towards the target and points the queue, the cursor and the bullet
+    // traces at its view. Call before anything is pushed this frame.
+    void updateCamera(RenderQueue& queue, float targetX, float targetY, float deltaTime) {
+        camera.follow(targetX, targetY, deltaTime);
+        input.setView(camera.getX(), camera.getY(), camera.getHalfWidth(), camera.getHalfHeight());
+        queue.setCamera(camera);
+
+        int width, height;
+        input.getWindowSize(&width, &height);
+        BulletTracePool::getInstance().setView(camera, width, height);
+    }
+
 public:
-    GameLevel(GLFWwindow* win) : window(win) {}
+    GameLevel(Input& in) : input(in) {}
     virtual ~GameLevel() = default;
 
     virtual void init() = 0;
     virtual void cleanup() = 0;
     virtual void draw(float deltaTime) = 0;
-    virtual void handleMouseClick(GLFWwindow* window, int button, int action, int mods) = 0;
+    virtual void handleMouseClick(const Input& input, int button, int action, int mods) = 0;
 
     static void setCurrentLevel(GameLevel* level) {
         currentLevel = level;
     }
 
     static void globalMouseCallback(GLFWwindow* window, int button, int action, int mods) {
+        dispatchMouseClick(button, action, mods);
+    }
+
+    // Also the entry point for scripted clicks when running headless
+    static void dispatchMouseClick(int button, int action, int mods) {
         if (currentLevel) {
-            currentLevel->handleMouseClick(window, button, action, mods);
+            currentLevel->handleMouseClick(currentLevel->input, button, action, mods);
         }
     }
 };
@@ -52,10 +82,16 @@ private:
     static GameManager* instance;
     std::stack<std::unique_ptr<GameLevel>> levels;
     GLFWwindow* window = nullptr;
+    std::unique_ptr<Input> input;
+    RenderThread renderThread;
+    bool waitForStreaming = false;   // headless: levels start with every texture resident
 
     GameManager() = default;
 
 public:
+    // Written by main --cook; without it every asset is read from its loose file
+    static constexpr const char* packPath = "cooked/assets.pak";
+
     static GameManager* getInstance() {
         if (instance == nullptr) {
             instance = new GameManager();
@@ -63,20 +99,103 @@ public:
         return instance;
     }
 
+    // Hands the GL context to the render thread and loads the shared resources there
     void init(GLFWwindow* win) {
         window = win;
+        AssetPack::getInstance().open(packPath);
+        input.reset(new Input(window));
         glfwSetMouseButtonCallback(window, GameLevel::globalMouseCallback);
+        renderThread.start(window);
+        loadSharedResources();
+    }
+
+    // No window and no GLFW: input is scripted and the installed RenderBackend gets every call
+    void initHeadless(int width, int height) {
+        window = nullptr;
+        waitForStreaming = true;
+        AssetPack::getInstance().open(packPath);
+        input.reset(new Input(width, height));
+        renderThread.start(nullptr);
+        loadSharedResources();
+    }
+
+    void loadSharedResources() {
+        renderThread.invoke([this] {
+            // The driver builds the programs (in parallel where it can) while the atlas is packed
+            ProgramCache& programs = ProgramCache::getInstance();
+            programs.preload(shaderPrograms());
+            buildAtlas();
+            programs.finishAll();
+            const ProgramCache::Stats& stats = programs.getStats();
+            std::cout << "Programs: " << stats.compiled << " compiled, " << stats.loadedBinaries
+                << " loaded from the binary cache, " << stats.seconds * 1000.0 << " ms" << std::endl;
+            // Created up front so the simulation never constructs it, and its GL objects, itself
+            BulletTracePool::getInstance();
+        });
+    }
+
+    void shutdown() {
+        renderThread.stop();
+    }
+
+    // Every sheet the levels animate or draw from; the cooker packs the same list
+    static void registerAtlasSheets(TextureAtlas& atlas) {
+        atlas.add("texture/character/character.png", 4, 2, TextureFilter::Nearest);
+        atlas.add("texture/arm.png", 4, 2, TextureFilter::Nearest);
+        atlas.add("texture/enemi_texture.png", 4, 2, TextureFilter::Nearest);
+        atlas.add("texture/enemi_caterpillar.png", 4, 2, TextureFilter::Nearest);
+        atlas.add("texture/particle.png", 1, 1, TextureFilter::Linear);
+        atlas.add("texture/bullet_trace.png", 1, 1, TextureFilter::Linear);
+        atlas.add("texture/wall.jpeg", 1, 1, TextureFilter::Linear);
+    }
+
+    // Every program the game draws with, as (vertex, fragment) files: the one sprite program.
+    // main --embed-shaders compiles the same list into shader_sources.h.
+    static std::vector<std::pair<std::string, std::string>> shaderPrograms() {
+        return { { "vertex_sprite.glsl", "fragment_sprite.glsl" } };
+    }
+
+    // Every texture the levels use is packed here once, before the first level is created.
+    // A cooked atlas (main --cook) is uploaded as is when it matches these sheets.
+    void buildAtlas() {
+        TextureAtlas& atlas = TextureAtlas::getInstance();
+        registerAtlasSheets(atlas);
+        atlas.build("cooked");
+    }
+
+    // The queue the current frame pushes its draw commands into
+    RenderQueue& getRenderQueue() {
+        return renderThread.frameQueue();
     }
 
+    RenderThread& getRenderThread() {
+        return renderThread;
+    }
+
+    Input& getInput() {
+        return *input;
+    }
+
+    // Levels create and free GL objects, so the switch itself runs on the render thread
+    // while the simulation waits
     template<typename T>
     void changeLevel(std::unique_ptr<T> level) {
-        if (!levels.empty()) {
-            levels.top()->cleanup();
-            levels.pop();
-        }
-        level->init();
+        renderThread.invoke([&] {
+            if (!levels.empty()) {
+                levels.top()->cleanup();
+                levels.pop();
+                BulletTracePool::getInstance().clear();
+            }
+            level->init();
+            // Otherwise textures the level streams in arrive over the next frames
+            if (waitForStreaming) TextureStreamer::getInstance().finish();
+            // After init, so what the new level shares with the old one stays resident
+            TextureCache::getInstance().purgeUnused();
+        });
         GameLevel::setCurrentLevel(level.get()); // Set current level before pushing
         levels.push(std::move(level));
+        // Whatever the old level pushed this frame points at objects that are gone now
+        renderThread.frameQueue().clear();
     }
 
     void runGameLoop() {
@@ -87,14 +206,28 @@ public:
             float deltaTime = currentFrame - lastFrame;
             lastFrame = currentFrame;
 
+            Animator::getInstance().update(deltaTime);
             if (!levels.empty()) {
                 levels.top()->draw(deltaTime);
             }
 
-            glfwSwapBuffers(window);
+            // Submission and the swap happen on the render thread while the next frame is simulated
+            renderThread.publish();
             glfwPollEvents();
         }
     }
+
+    // Headless loop: a fixed time step, script(frame) sets up the input of each frame
+    void runFrames(int frames, float deltaTime, const std::function<void(int)>& script) {
+        for (int frame = 0; frame < frames; ++frame) {
+            script(frame);
+            Animator::getInstance().update(deltaTime);
+            if (!levels.empty()) {
+                levels.top()->draw(deltaTime);
+            }
+            renderThread.publish();
+        }
+    }
 };
 
 // Initialize the static instance
@@ -109,96 +242,97 @@ private:
     Collide* ground;
     Collide* platform1;
     Collide* platform2;
+    LevelGeometry* geometry;
     Arm* arm;
     Crosshair* crosshair;
     Boss* boss;
     ParticleEmitter* particle;
     ParticleEmitter* fallparticle;
-    float particleCooldown = 3.0f, timeSinceLastParticle = 0.0f;
-    float FallparticleCooldown = 2.5f, timeSinceLastFallParticle = 0.0f;
-    bool change = false;
+    float particleCooldown = 3.0f;
+    float FallparticleCooldown = 2.5f;
 
 public:
-    Level2(GLFWwindow* win) :
-        GameLevel(win),
+    Level2(Input& in) :
+        GameLevel(in),
         player(nullptr),
         enemi(nullptr),
         boss(nullptr),
         ground(nullptr),
         platform1(nullptr),
         platform2(nullptr),
+        geometry(nullptr),
         arm(nullptr),
         particle(nullptr),
         fallparticle(nullptr),
         crosshair(nullptr) {}
 
 
-    void handleMouseClick(GLFWwindow* window, int button, int action, int mods) override {
+    void handleMouseClick(const Input& input, int button, int action, int mods) override {
         if (enemi) {
-            enemi->handleMouseClick(window, button, action, mods);
+            enemi->handleMouseClick(input, button, action, mods);
         }
         if (boss) {
-            boss->handleMouseClick(window, button, action, mods);
+            boss->handleMouseClick(input, button, action, mods);
         }
         if (particle) {
-            particle->handleMouseClick(window, button, action, mods);
+            particle->handleMouseClick(input, button, action, mods);
         }
         if (fallparticle) {
-            fallparticle->handleMouseClick(window, button, action, mods);
+            fallparticle->handleMouseClick(input, button, action, mods);
         }
     }
 
     void init() override {
 
         int width, height;
-        glfwGetWindowSize(window, &width, &height);
+        input.getWindowSize(&width, &height);
+
+        camera.setBounds(worldMinX, worldMinY, worldMaxX, worldMaxY);
 
         ground = new Collide(
             0.0f, -0.9f, 2.0f, 0.1f, 1.0f,
-            "vertex_full.glsl",
-            "fragment_full.glsl",
             "texture/wall.jpeg"
         );
 
+        geometry = new LevelGeometry();
+        geometry->add(*ground);
+        geometry->bake();
+
         player = new Character(
             -0.9f, 0.0f, 0.1f, 0.55f, 0.6f,
-            "vertex.glsl", "fragment.glsl",
             "texture/character/character.png"
         );
 
         enemi = new Enemi(
             0.0f, 1.0f, 0.09f, 0.09f, 0.3f, 100000,
-            "vertex.glsl", "fragment.glsl",
-            "texture/enemi_caterpillar.png",
-            "vertex_BulletTrace.glsl", "fragment_BulletTrace.glsl"
+            "texture/enemi_caterpillar.png"
         );
         boss = new Boss(
             0.9f, -0.5f, 0.09f, 0.35f, 0.0f, 500,
-            "vertex.glsl", "fragment.glsl",
             "texture/enemi_texture.png",
-            "vertex_BulletTrace.glsl", "fragment_BulletTrace.glsl",
             width, height
         );
 
         arm = new Arm(
             0.0f, 0.0f, 0.01f, 0.05f, 2.0f,
-            "vertex_arm.glsl", "fragment_arm.glsl",
             "texture/arm.png"
         );
 
         particle = new ParticleEmitter(
             0.9f, -0.5f, 0.18f, 0.18f, 0.9f,
-            "vertex_particle.glsl", "fragment_particle.glsl",
             "texture/particle.png",
             width, height, false
         );
+        particle->setSpawnRate(1.0f / particleCooldown);
+        particle->setBounds(worldMinX, worldMinY, worldMaxX, worldMaxY);
 
         fallparticle = new ParticleEmitter(
             0.0f, 0.7f, 0.18f, 0.18f, 1.1f,
-            "vertex_particle.glsl", "fragment_particle.glsl",
             "texture/particle.png",
             width, height, true 
         );
+        fallparticle->setSpawnRate(1.0f / FallparticleCooldown);
+        fallparticle->setBounds(worldMinX, worldMinY, worldMaxX, worldMaxY);
 
         crosshair = new Crosshair(0.03f);
 
@@ -244,23 +378,17 @@ public:
             boss = nullptr;
         }
 
-        //         
-        if ((!boss || !boss->getIsAlive() || change) && particle) {
+        //  
+        if (particle) {
             delete particle;
             particle = nullptr;
-            change = false;
         }
 
-        if ((!boss || !boss->getIsAlive() || change) && fallparticle) {
+        if (fallparticle) {
             delete fallparticle;
             fallparticle = nullptr;
-            change = false;
         }
 
-
-        //delete particle;
-        //particle = nullptr;
-
         //  
         if (player) {
             delete player;
@@ -282,76 +410,81 @@ public:
             delete platform2;
             platform2 = nullptr;
         }
+
+        if (geometry) {
+            delete geometry;
+            geometry = nullptr;
+        }
     }
 
     void draw(float deltaTime) {
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        timeSinceLastParticle += deltaTime;
-        timeSinceLastFallParticle += deltaTime;
+        RenderQueue& queue = GameManager::getInstance()->getRenderQueue();
+        queue.setClearColor(0.2f, 0.3f, 0.3f);
+        updateCamera(queue, player->getX(), player->getY(), deltaTime);
 
-        ground->draw();
+        geometry->draw(queue);
 
-        arm->processInput(window, deltaTime);
-        arm->draw(window, deltaTime);
+        arm->processInput(input, deltaTime);
+        arm->draw(queue, input, deltaTime);
 
-        player->processInput(window, deltaTime);
-        player->draw(window, deltaTime);
+        player->processInput(input, deltaTime);
+        player->draw(queue);
         player->update(deltaTime);
 
         if (enemi && enemi->getIsAlive() && boss && boss->getIsAlive()) {
-            enemi->processInput(window, deltaTime);
-            enemi->draw(deltaTime);
+            enemi->processInput(input, deltaTime);
+            enemi->draw(queue);
         }
 
         if (boss && boss->getIsAlive()) {
-            boss->processInput(window, deltaTime);
-            boss->draw(deltaTime);
+            boss->processInput(input, deltaTime);
+            boss->draw(queue);
         }
         else{
             enemi->make_dead();
         }
 
 
-        if (fallparticle && fallparticle->getIsAlive()) {
-            fallparticle->processInput(window, deltaTime);
-            fallparticle->drawParticles();
+        // The boss keeps shooting and the rain keeps falling only while the boss is alive
+        bool bossAlive = boss && boss->getIsAlive();
+
+        if (fallparticle) {
+            fallparticle->setEmitting(bossAlive);
+            fallparticle->processInput(input, deltaTime);
         }
-        else if (timeSinceLastFallParticle >= FallparticleCooldown && boss && boss->getIsAlive() && fallparticle && !fallparticle->getIsAlive()) {
-            timeSinceLastFallParticle = 0.0f;
-            fallparticle->restart();
-        
+
+        if (particle) {
+            particle->setEmitting(bossAlive);
+            particle->processInput(input, deltaTime);
         }
 
-        if (particle && particle->getIsAlive()) {
-            particle->processInput(window, deltaTime);
-            particle->drawParticles();
+        BulletTracePool::getInstance().update(deltaTime);
+        BulletTracePool::getInstance().draw(queue);
+
+        if (fallparticle) {
+            fallparticle->draw(queue);
         }
-        else if (timeSinceLastParticle >= particleCooldown && boss && boss->getIsAlive() && particle && !particle->getIsAlive()) {
-            timeSinceLastParticle = 0.0f;
-            particle->restart();
 
+        if (particle) {
+            particle->draw(queue);
         }
 
-        crosshair->draw(window);
+        crosshair->draw(queue, input);
 
-        if (player->getX() < -1.0f) {
-            change = true;
+
+        if (player->getX() < worldMinX) {
             GameManager::getInstance()->changeLevel<Level1>(
-                std::make_unique<Level1>(window)
+                std::make_unique<Level1>(input)
             );
         }
         else if (player->getY() < -2.0f) {
-            change = true;
             GameManager::getInstance()->changeLevel<Level2>(
-                std::make_unique<Level2>(window)
+                std::make_unique<Level2>(input)
             );
         }
         else if (!player->getIsAlive()) {
-            change = true;
             GameManager::getInstance()->changeLevel<Level2>(
-                std::make_unique<Level2>(window)
+                std::make_unique<Level2>(input)
             );
         }
 
@@ -372,75 +505,73 @@ private:
     Collide* ground;
     Collide* platform1;
     Collide* platform2;
+    LevelGeometry* geometry;
     Arm* arm;
     Crosshair* crosshair;
 
 
 public:
-    Level1(GLFWwindow* win) :
-        GameLevel(win),
+    Level1(Input& in) :
+        GameLevel(in),
         player(nullptr),
         enemi(nullptr),
         enemi2(nullptr),
         ground(nullptr),
         platform1(nullptr),
         platform2(nullptr),
+        geometry(nullptr),
         arm(nullptr),
         crosshair(nullptr) {}
 
 
-    void handleMouseClick(GLFWwindow* window, int button, int action, int mods) override {
+    void handleMouseClick(const Input& input, int button, int action, int mods) override {
         if (enemi) {
-            enemi->handleMouseClick(window, button, action, mods);
+            enemi->handleMouseClick(input, button, action, mods);
         }
         if (enemi2) {
-            enemi2->handleMouseClick(window, button, action, mods);
+            enemi2->handleMouseClick(input, button, action, mods);
         }
     }
 
     void init() override {
+        camera.setBounds(worldMinX, worldMinY, worldMaxX, worldMaxY);
+
         ground = new Collide(
             0.0f, -0.9f, 2.0f, 0.1f, 1.0f,
-            "vertex_full.glsl",
-            "fragment_full.glsl",
             "texture/wall.jpeg"
         );
         platform1 = new Collide(
             0.3f, -0.5f, 0.5f, 0.1f, 1.0f,
-            "vertex_full.glsl",
-            "fragment_full.glsl",
             "texture/wall.jpeg"
         );
         platform2 = new Collide(
             -0.4f, -0.08f, 0.5f, 0.1f, 1.0f,
-            "vertex_full.glsl",
-            "fragment_full.glsl",
             "texture/wall.jpeg"
         );
 
+        geometry = new LevelGeometry();
+        geometry->add(*ground);
+        geometry->add(*platform1);
+        geometry->add(*platform2);
+        geometry->bake();
+
         player = new Character(
             0.9f, 0.0f, 0.1f, 0.55f, 0.5f,
-            "vertex.glsl", "fragment.glsl",
             "texture/character/character.png"
         );
 
         enemi = new Enemi(
             0.0f, 1.0f, 0.09f, 0.35f, 0.1f, 100,
-            "vertex.glsl", "fragment.glsl",
-            "texture/enemi_texture.png",
-            "vertex_BulletTrace.glsl", "fragment_BulletTrace.glsl"
+            "texture/enemi_texture.png"
         );
 
         enemi2 = new Enemi(
             0.0f, 1.0f, 0.09f, 0.35f, 0.3f, 100,
-            "vertex.glsl", "fragment.glsl",
-            "texture/enemi_texture.png",
-            "vertex_BulletTrace.glsl", "fragment_BulletTrace.glsl"
+            "texture/enemi_texture.png"
         );
 
         arm = new Arm(
             0.0f, 0.0f, 0.01f, 0.05f, 2.0f,
-            "vertex_arm.glsl", "fragment_arm.glsl",
             "texture/arm.png"
         );
 
@@ -514,49 +645,57 @@ public:
             delete platform2;
             platform2 = nullptr;
         }
+
+        if (geometry) {
+            delete geometry;
+            geometry = nullptr;
+        }
     }
 
     void draw(float deltaTime) {
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        RenderQueue& queue = GameManager::getInstance()->getRenderQueue();
+        queue.setClearColor(0.2f, 0.3f, 0.3f);
+        updateCamera(queue, player->getX(), player->getY(), deltaTime);
 
-        ground->draw();
-        platform1->draw();
-        platform2->draw();
+        geometry->draw(queue);
 
-        arm->processInput(window, deltaTime);
-        arm->draw(window, deltaTime);
+        arm->processInput(input, deltaTime);
+        arm->draw(queue, input, deltaTime);
 
-        player->processInput(window, deltaTime);
-        player->draw(window, deltaTime);
+        player->processInput(input, deltaTime);
+        player->draw(queue);
         player->update(deltaTime);
 
 
         if (enemi && enemi->getIsAlive()) {
-            enemi->processInput(window, deltaTime);
-            enemi->draw(deltaTime);
+            enemi->processInput(input, deltaTime);
+            enemi->draw(queue);
         }
 
         if (enemi2 && enemi2->getIsAlive()) {
-            enemi2->processInput(window, deltaTime);
-            enemi2->draw(deltaTime);
+            enemi2->processInput(input, deltaTime);
+            enemi2->draw(queue);
         }
 
-        crosshair->draw(window);
+        BulletTracePool::getInstance().update(deltaTime);
+        BulletTracePool::getInstance().draw(queue);
+
+        crosshair->draw(queue, input);
+
 
-        if (player->getX() > 1.0f) {
+        if (player->getX() > worldMaxX) {
             GameManager::getInstance()->changeLevel<Level2>(
-                std::make_unique<Level2>(window)
+                std::make_unique<Level2>(input)
             );
         }
         else if (player->getY() < -2.0f) {
             GameManager::getInstance()->changeLevel<Level1>(
-                std::make_unique<Level1>(window)
+                std::make_unique<Level1>(input)
             );
         }
         else if (!player->getIsAlive()) {
             GameManager::getInstance()->changeLevel<Level1>(
-                std::make_unique<Level1>(window)
+                std::make_unique<Level1>(input)
             );
         }
 
@@ -572,9 +711,9 @@ public:
 // Main menu implementation
 class MainMenu : public GameLevel {
 public:
-    MainMenu(GLFWwindow* win) : GameLevel(win) {}
+    MainMenu(Input& in) : GameLevel(in) {}
 
-    void handleMouseClick(GLFWwindow* window, int button, int action, int mods) override {
+    void handleMouseClick(const Input& input, int button, int action, int mods) override {
         // Handle menu mouse clicks if needed
     }
 
@@ -587,12 +726,11 @@ public:
     }
 
     void draw(float deltaTime) override {
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        GameManager::getInstance()->getRenderQueue().setClearColor(0.1f, 0.1f, 0.1f);
 
-        if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+        if (input.isKeyDown(GLFW_KEY_SPACE)) {
             GameManager::getInstance()->changeLevel<Level1>(
-                std::make_unique<Level1>(window)
+                std::make_unique<Level1>(input)
             );
         }
     }
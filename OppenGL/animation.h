@@ -0,0 +1,172 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "texture_atlas.h"
+
+// The frames of one sprite sheet and how long each is shown. Immutable once loaded and
+// shared by every entity that plays it.
+struct AnimationClip {
+    std::vector<AtlasFrame> frames;
+    float frameTime;
+};
+
+// Loads each clip once per process; later requests for the same sheet, grid, filter and
+// frame time get the same clip
+class AnimationLibrary {
+private:
+    std::unordered_map<std::string, std::unique_ptr<AnimationClip>> clips;
+
+    // "path|4x2|nearest|<frameTime bits>": a sheet cut or timed differently is another clip
+    static std::string clipKey(const std::string& path, int columns, int rows, TextureFilter filter, float frameTime) {
+        uint32_t timeBits;
+        std::memcpy(&timeBits, &frameTime, sizeof(timeBits));
+        return path + "|" + std::to_string(columns) + "x" + std::to_string(rows) +
+            (filter == TextureFilter::Nearest ? "|nearest|" : "|linear|") + std::to_string(timeBits);
+    }
+
+    // The atlas (and the texture cache under it) has to outlive the frames kept here
+    AnimationLibrary() { TextureAtlas::getInstance(); }
+
+public:
+    static AnimationLibrary& getInstance() {
+        static AnimationLibrary instance;
+        return instance;
+    }
+
+    AnimationLibrary(const AnimationLibrary&) = delete;
+    AnimationLibrary& operator=(const AnimationLibrary&) = delete;
+
+    // A sheet of columns x rows frames, played left to right, top to bottom
+    const AnimationClip& getClip(const std::string& path, int columns, int rows, TextureFilter filter, float frameTime) {
+        std::string key = clipKey(path, columns, rows, filter, frameTime);
+        auto it = clips.find(key);
+        if (it != clips.end()) {
+            return *it->second;
+        }
+        std::unique_ptr<AnimationClip> clip(new AnimationClip());
+        clip->frames = TextureAtlas::getInstance().getFrames(path, columns, rows, filter);
+        clip->frameTime = frameTime;
+        return *clips.emplace(key, std::move(clip)).first->second;
+    }
+};
+
+// Plays the animations of every entity. State lives in parallel arrays, one entry per
+// animation, and update() advances all of them in one pass over contiguous memory.
+// Entities keep a handle; handles stay valid while other animations come and go.
+//
+// A playing animation loops through its clip, a stopped one rests on the first frame.
+class Animator {
+public:
+    typedef uint32_t Handle;
+    static const Handle invalidHandle = 0xFFFFFFFFu;
+
+private:
+    // Dense, swap-removed arrays
+    std::vector<const AnimationClip*> clip;
+    std::vector<float> elapsed;
+    std::vector<float> frameTime;
+    std::vector<uint32_t> frame;
+    std::vector<uint32_t> frameCount;
+    std::vector<uint8_t> playing;
+    std::vector<Handle> owner;          // dense index -> handle
+
+    std::vector<uint32_t> denseIndex;   // handle -> dense index
+    std::vector<Handle> freeHandles;
+
+    Animator() = default;
+
+public:
+    static Animator& getInstance() {
+        static Animator instance;
+        return instance;
+    }
+
+    Animator(const Animator&) = delete;
+    Animator& operator=(const Animator&) = delete;
+
+    Handle create(const AnimationClip& animation) {
+        Handle handle;
+        if (!freeHandles.empty()) {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+        }
+        else {
+            handle = static_cast<Handle>(denseIndex.size());
+            denseIndex.push_back(0);
+        }
+        denseIndex[handle] = static_cast<uint32_t>(clip.size());
+
+        clip.push_back(&animation);
+        elapsed.push_back(0.0f);
+        frameTime.push_back(animation.frameTime);
+        frame.push_back(0);
+        frameCount.push_back(static_cast<uint32_t>(animation.frames.size()));
+        playing.push_back(0);
+        owner.push_back(handle);
+        return handle;
+    }
+
+    // Moves the last animation into the freed slot
+    void destroy(Handle handle) {
+        if (handle == invalidHandle) return;
+        uint32_t i = denseIndex[handle];
+        uint32_t last = static_cast<uint32_t>(clip.size()) - 1;
+
+        clip[i] = clip[last];
+        elapsed[i] = elapsed[last];
+        frameTime[i] = frameTime[last];
+        frame[i] = frame[last];
+        frameCount[i] = frameCount[last];
+        playing[i] = playing[last];
+        owner[i] = owner[last];
+        denseIndex[owner[i]] = i;
+
+        clip.pop_back();
+        elapsed.pop_back();
+        frameTime.pop_back();
+        frame.pop_back();
+        frameCount.pop_back();
+        playing.pop_back();
+        owner.pop_back();
+
+        freeHandles.push_back(handle);
+    }
+
+    void setPlaying(Handle handle, bool value) {
+        playing[denseIndex[handle]] = value ? 1 : 0;
+    }
+
+    const AtlasFrame& getFrame(Handle handle) const {
+        uint32_t i = denseIndex[handle];
+        return clip[i]->frames[frame[i]];
+    }
+
+    // Once per frame, before anything draws
+    void update(float deltaTime) {
+        size_t count = clip.size();
+        for (size_t i = 0; i < count; ++i) {
+            if (playing[i]) {
+                elapsed[i] += deltaTime;
+                if (elapsed[i] >= frameTime[i]) {
+                    uint32_t next = frame[i] + 1;
+                    frame[i] = next < frameCount[i] ? next : 0;
+                    elapsed[i] = 0.0f;
+                }
+            }
+            else {
+                frame[i] = 0;
+            }
+        }
+    }
+
+    size_t size() const { return clip.size(); }
+};
+
+#endif // ANIMATION_H
@@ -16,17 +16,13 @@
 #include <sstream> 
 #include <iostream> 
 
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
-#include "shader.h"
-#include "stb_image.h"
+#include "render_queue.h"
+#include "animation.h"
 #include "collide.h"
 #include "character.h"
 #include "enemi.h"
 
-#include <GLFW/glfw3.h>
+#include "input.h"
 
 
 
@@ -36,13 +32,7 @@ private:
     float x, y;
     float speed;
     float width, height;
-    unsigned int VAO, VBO, EBO;
-    unsigned int VAO_vertical, VAO_horizontal;
-    unsigned int VBO_vertical, VBO_horizontal;
-    unsigned int EBO_vertical, EBO_horizontal;
 
-    unsigned int texture1, texture2;
-    Shader shader;
     std::vector<Collide*> collideObjects;
 
     Character* character;
@@ -58,10 +48,7 @@ private:
     float characterWidth = 0.15f;  // Øèðèíà ïåðñîíàæà â èãðîâîì ìèðå
     float characterHeight = 0.55f; // Âûñîòà ïåðñîíàæà â èãðîâîì ìèðå
 
-    std::vector<Vec4> frames;  // Texture coordinates for each frame
-    int currentFrame;
-    float frameTime;
-    float timeSinceLastFrame;
+    Animator::Handle animation;  // Walk cycle, advanced by the Animator
     bool isMoving;
     bool facingRight;
 
@@ -72,92 +59,26 @@ private:
 
     float angel;
 
-    unsigned int loadTexture(const char* path) {
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-
-
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-        int width, height, nrChannels;
-        unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 4);
-
-        if (data) {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            int framesPerRow = 4;  // Adjust based on your spritesheet
-            int framesPerColumn = 4;
-            float frameWidth = 1.0f / framesPerRow;
-            float frameHeight = 1.0f / framesPerColumn;
-
-            for (int y = 0; y < framesPerColumn; ++y) {
-                for (int x = 0; x < framesPerRow; ++x) {
-                    frames.push_back(Vec4(
-                        x * frameWidth, y * frameHeight,
-                        (x + 1) * frameWidth, (y + 1) * frameHeight
-                    ));
-                }
-            }
-        }
-        else {
-            std::cout << "Failed to load texture" << std::endl;
-        }
-        stbi_image_free(data);
-        return textureID;
-    }
-
-    void calculateTextureCoords() {
-        int framesPerRow = 4;
-        int framesPerColumn = 2;  // Изменено на 2, так как у нас 2 ряда кадров
-        float frameWidth = 1.0f / framesPerRow;
-        float frameHeight = 1.0f / framesPerColumn;
-
-        frames.clear();
-        for (int y = 0; y < framesPerColumn; ++y) {
-            for (int x = 0; x < framesPerRow; ++x) {
-                frames.push_back(Vec4(
-                    x * frameWidth,
-                    1.0f - (y + 1) * frameHeight,  // Инвертируем Y-координату
-                    (x + 1) * frameWidth,
-                    1.0f - y * frameHeight  // Инвертируем Y-координату
-                ));
-            }
-        }
-    }
 
 
 public:
     Arm(float startX, float startY, float characterWidth, float characterHeight, float moveSpeed,
-        const char* vertexPath, const char* fragmentPath,
         const char* texturePath)
         : x(startX), y(startY), width(characterWidth), height(characterHeight), speed(moveSpeed),
-        shader(vertexPath, fragmentPath), verticalVelocity(0.0f), isOnGround(false),
-        currentFrame(0), frameTime(0.07f), timeSinceLastFrame(0.0f), isMoving(false), facingRight(true),
+        verticalVelocity(0.0f), isOnGround(false),
+        animation(Animator::invalidHandle), isMoving(false), facingRight(true),
         quadLeft(-width / 2), quadRight(width / 2), quadTop(height / 2), quadBottom(-height / 2),
         hp(100), isAlive(true)  // Initialize hp and isAlive
     {
-        setupMesh();
-        texture1 = loadTexture(texturePath);
-        calculateTextureCoords();
+        animation = Animator::getInstance().create(
+            AnimationLibrary::getInstance().getClip(texturePath, 4, 2, TextureFilter::Nearest, 0.07f));
     }
 
-    void updateAnimation(float deltaTime) {
-        if (isMoving) {
-            timeSinceLastFrame += deltaTime;
-            if (timeSinceLastFrame >= frameTime) {
-                currentFrame = (currentFrame + 1) % 8;  // Предполагаем, что у нас 8 кадров анимации
-                timeSinceLastFrame = 0.0f;
-            }
-        }
-        else {
-            currentFrame = 0;  // Кадр покоя
-        }
+    Arm(const Arm&) = delete;
+    Arm& operator=(const Arm&) = delete;
+
+    ~Arm() {
+        Animator::getInstance().destroy(animation);
     }
 
     void addCollideObject(Collide* obj) {
@@ -196,74 +117,6 @@ public:
 
 
 
-    void setupMesh() {
-        // Âåðòèêàëüíîå ñîñòîÿíèå
-        float vertices_vertical[] = {
-            // Positions                              // Colors           // Texture Coords
-              0.7f,  0.37f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 0.0f, // Top Right
-              0.7f, -0.37f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 1.0f, // Bottom Right
-             -0.7f, -0.37f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 1.0f, // Bottom Left
-             -0.7f,  0.37f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 0.0f  // Top Left 
-        };
-
-        // Ãîðèçîíòàëüíîå ñîñòîÿíèå
-        float vertices_horizontal[] = {
-            // Positions                              // Colors           // Texture Coords
-              0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 0.0f, // Top Right
-              0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 1.0f, // Bottom Right
-             -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 1.0f, // Bottom Left
-             -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 0.0f  // Top Left 
-        };
-
-        unsigned int indices[] = {
-            0, 1, 3,
-            1, 2, 3
-        };
-
-        // Íàñòðîéêà âåðòèêàëüíîãî VAO
-        glGenVertexArrays(1, &VAO_vertical);
-        glGenBuffers(1, &VBO_vertical);
-        glGenBuffers(1, &EBO_vertical);
-
-        glBindVertexArray(VAO_vertical);
-
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_vertical);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices_vertical), vertices_vertical, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_vertical);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-
-        // Íàñòðîéêà ãîðèçîíòàëüíîãî VAO
-        glGenVertexArrays(1, &VAO_horizontal);
-        glGenBuffers(1, &VBO_horizontal);
-        glGenBuffers(1, &EBO_horizontal);
-
-        glBindVertexArray(VAO_horizontal);
-
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_horizontal);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices_horizontal), vertices_horizontal, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_horizontal);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-    }
-
     float getX() const { return x; }
     float getY() const { return y; }
 
@@ -314,7 +167,7 @@ public:
         //if (dx > 0) facingRight = true;
         //else if (dx < 0) facingRight = false;
 
-        updateAnimation(deltaTime);
+        Animator::getInstance().setPlaying(animation, isMoving);
     }
 
 
@@ -331,26 +184,17 @@ public:
         angel -= 1.5f;
     }
 
-    void draw(GLFWwindow* window, float deltaTime) {
-        shader.Use();
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        shader.setInt("ourTexture1", 0);
-
-        Vec4 texCoords = frames[currentFrame];
+    void draw(RenderQueue& queue, const Input& input, float deltaTime) {
+        const AtlasFrame& frame = Animator::getInstance().getFrame(animation);
+        Vec4 texCoords = frame.texCoords;
         if (!facingRight) {
             std::swap(texCoords.x, texCoords.z);
         }
         //std::cout << "facingRight: " << facingRight << ";     isMoving: " << isMoving << std::endl;
 
 
-        double xpos, ypos;
-        glfwGetCursorPos(window, &xpos, &ypos);
-        int width, height;
-        glfwGetWindowSize(window, &width, &height);
-        float clickX = (2.0f * xpos) / width - 1.0f;
-        float clickY = 1.0f - (2.0f * ypos) / height;
+        float clickX, clickY;
+        input.getCursorWorld(&clickX, &clickY);
 
         // Adjust click coordinates based on enemy position
         clickX -= x;
@@ -364,39 +208,17 @@ public:
         bool use_vertical = (angle_normalized > M_PI / 4 && angle_normalized < 3 * M_PI / 4) ||
             (angle_normalized > 5 * M_PI / 4 && angle_normalized < 7 * M_PI / 4);
 
-        float pi = M_PI;
-
-        glm::mat4 transform = glm::mat4(1.0f);
-        transform = glm::translate(transform, glm::vec3(x, y, 0.0f));
-        transform = glm::rotate(transform, angel, glm::vec3(0.0f, 0.0f, 1.0f));
-
-        transform = glm::scale(transform, glm::vec3(characterWidth, characterHeight, 1.0f));
+        // The vertical pose is a 1.4 x 0.74 quad, the horizontal one a unit quad,
+        // both scaled by the arm size before rotating
+        float quadWidth = use_vertical ? 1.4f : 1.0f;
+        float quadHeight = use_vertical ? 0.74f : 1.0f;
 
-
-        // Âðåìåííî îòêëþ÷èì âðàùåíèå äëÿ îòëàäêè
-        // transform = glm::rotate(transform, (GLfloat)glfwGetTime() * 50.0f, glm::vec3(0.0f, 0.0f, 1.0f));
-
-        // Óñòàíîâêà uniform-ïåðåìåííûõ
-        GLint transformLoc = glGetUniformLocation(shader.Program, "transform");
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transform));
-
-        //glUniform1f(glGetUniformLocation(shader.Program, "mixValue"), mixValue);
-        //glUniform1f(glGetUniformLocation(shader.Program, "y_mov"), y);
-        //glUniform1f(glGetUniformLocation(shader.Program, "x_mov"), x);
-        //glUniform1f(glGetUniformLocation(shader.Program, "y_target"), xpos);
-        //glUniform1f(glGetUniformLocation(shader.Program, "x_target"), ypos);
-
-        shader.setVec4("texCoords", texCoords.x, texCoords.y, texCoords.z, texCoords.w);
-
-
-        glBindVertexArray(use_vertical ? VAO_vertical : VAO_horizontal);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        queue.push(RenderLayer::World, frame.texture.id(), Sprite(x, y, quadWidth * characterWidth, quadHeight * characterHeight, texCoords, angel, 1.0f, frame.shape));
     }
 
 
 
-    void processInput(GLFWwindow* window, float deltaTime) {
+    void processInput(const Input& input, float deltaTime) {
         float dx = 0;
         float dy = 0;
 
@@ -424,12 +246,6 @@ public:
         move(dx, dy, deltaTime);
     }
 
-    ~Arm() {
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-        glDeleteBuffers(1, &EBO);
-    }
-
 
 
 
@@ -0,0 +1,185 @@
+#ifndef ASSET_COOK_H
+#define ASSET_COOK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "asset_pack.h"
+#include "texture_atlas.h"
+
+// Turns source assets into what the runtime uploads as is (see TextureAtlas::build(dir)).
+// Every output is recorded in <dir>/cook.db with a hash over its inputs' contents and
+// the settings it was cooked with; an output whose hash still matches is not cooked again.
+//
+//   <hash> <output> <input> <input> ...
+class AssetCooker {
+private:
+    struct Entry {
+        uint64_t hash;
+        std::vector<std::string> inputs;
+    };
+
+    // Bump when the cooked layout changes, so old outputs are redone
+    static const int cookerVersion = 1;
+
+    std::string outputDir;
+    bool etc;
+    std::map<std::string, Entry> database;
+    int cooked;
+    int upToDateCount;
+
+    std::string databasePath() const { return outputDir + "/cook.db"; }
+
+    static bool makeDirectory(const std::string& path) {
+#ifdef _WIN32
+        _mkdir(path.c_str());
+#else
+        mkdir(path.c_str(), 0755);
+#endif
+        std::ofstream probe(path + "/.probe", std::ios::trunc);
+        bool writable = probe.good();
+        probe.close();
+        std::remove((path + "/.probe").c_str());
+        return writable;
+    }
+
+    // FNV-1a, 64 bit
+    static uint64_t hashBytes(uint64_t hash, const char* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static uint64_t hashString(uint64_t hash, const std::string& text) {
+        return hashBytes(hash, text.data(), text.size() + 1);   // the terminator separates fields
+    }
+
+    void load() {
+        std::ifstream file(databasePath());
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            Entry entry;
+            std::string output, input;
+            if (!(fields >> std::hex >> entry.hash >> std::dec >> output)) continue;
+            while (fields >> input) entry.inputs.push_back(input);
+            database[output] = entry;
+        }
+    }
+
+public:
+    static const uint64_t emptyHash = 14695981039346656037ull;
+
+    AssetCooker(const std::string& outputDir, bool etc)
+        : outputDir(outputDir), etc(etc), cooked(0), upToDateCount(0) {
+        load();
+    }
+
+    // Content hash of a file; a missing file hashes differently from an empty one
+    static uint64_t hashFile(uint64_t hash, const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return hashString(hash, "<missing>");
+        char buffer[64 * 1024];
+        while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+            hash = hashBytes(hash, buffer, static_cast<size_t>(file.gcount()));
+        }
+        return hash;
+    }
+
+    bool upToDate(const std::string& output, uint64_t hash) const {
+        auto it = database.find(output);
+        return it != database.end() && it->second.hash == hash;
+    }
+
+    void record(const std::string& output, uint64_t hash, const std::vector<std::string>& inputs) {
+        database[output] = { hash, inputs };
+    }
+
+    bool save() const {
+        std::ofstream file(databasePath(), std::ios::trunc);
+        for (const auto& entry : database) {
+            file << std::hex << entry.second.hash << std::dec << ' ' << entry.first;
+            for (const std::string& input : entry.second.inputs) file << ' ' << input;
+            file << "\n";
+        }
+        return static_cast<bool>(file);
+    }
+
+    // Packs and compresses the sheets queued in atlas, unless nothing they depend on changed.
+    // The queue is left as it was, so the atlas can still be built afterwards.
+    bool cookAtlas(TextureAtlas& atlas) {
+        if (!makeDirectory(outputDir)) {
+            std::cerr << "Cook: cannot write to '" << outputDir << "'" << std::endl;
+            return false;
+        }
+
+        std::vector<std::string> inputs = atlas.getSheetPaths();
+        uint64_t hash = emptyHash;
+        hash = hashString(hash, std::to_string(cookerVersion));
+        hash = hashString(hash, etc ? "etc2" : "bc");
+        hash = hashString(hash, atlas.describeSheets());
+        for (const std::string& path : inputs) {
+            hash = hashFile(hash, path);
+            // A sheet with its own compressed texture is left out of the atlas
+            hash = hashFile(hash, TextureCache::compressedPath(path));
+        }
+
+        const std::string output = "atlas.txt";
+        if (upToDate(output, hash)) {
+            std::cout << "Cook: " << outputDir << "/" << output << " is up to date" << std::endl;
+            ++upToDateCount;
+            return true;
+        }
+        if (!atlas.writeCooked(outputDir, etc)) {
+            std::cerr << "Cook: failed to write the atlas to '" << outputDir << "'" << std::endl;
+            return false;
+        }
+        std::cout << "Cook: wrote " << outputDir << "/" << output << std::endl;
+        record(output, hash, inputs);
+        ++cooked;
+        return save();
+    }
+
+    // Bundles files into one pack, stored under their own paths; redone when any of them changes
+    bool cookPack(const std::string& name, const std::vector<std::string>& files) {
+        uint64_t hash = emptyHash;
+        hash = hashString(hash, std::to_string(cookerVersion) + " pak" + std::to_string(AssetPack::packVersion));
+        for (const std::string& path : files) {
+            hash = hashString(hash, path);
+            hash = hashFile(hash, path);
+        }
+
+        if (upToDate(name, hash)) {
+            std::cout << "Cook: " << outputDir << "/" << name << " is up to date" << std::endl;
+            ++upToDateCount;
+            return true;
+        }
+        AssetPackWriter writer;
+        for (const std::string& path : files) {
+            if (!writer.add(path)) return false;
+        }
+        if (!writer.write(outputDir + "/" + name)) return false;
+        record(name, hash, files);
+        ++cooked;
+        return save();
+    }
+
+    int getCookedCount() const { return cooked; }
+    int getUpToDateCount() const { return upToDateCount; }
+};
+
+#endif // ASSET_COOK_H
@@ -0,0 +1,526 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// LZ4 block format (no frame header): sequences of literals followed by a back reference
+// into the last 64 KB. Greedy single-probe matcher; decoding is a plain copy loop and
+// checks every length against both buffers.
+class LZ4Block {
+private:
+    static const size_t minMatch = 4;
+    static const size_t lastLiterals = 5;   // the format ends every block with literals
+    static const size_t matchLimit = 12;    // no match may start closer to the end
+    static const int hashBits = 12;
+
+    static uint32_t read32(const unsigned char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint32_t hash(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - hashBits);
+    }
+
+    static void writeLength(std::vector<unsigned char>& out, size_t length) {
+        for (; length >= 255; length -= 255) out.push_back(255);
+        out.push_back(static_cast<unsigned char>(length));
+    }
+
+    static void writeSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t literalCount,
+        size_t offset, size_t matchLength) {
+        size_t matchCode = matchLength ? matchLength - minMatch : 0;
+        out.push_back(static_cast<unsigned char>(((literalCount < 15 ? literalCount : 15) << 4) |
+            (matchCode < 15 ? matchCode : 15)));
+        if (literalCount >= 15) writeLength(out, literalCount - 15);
+        out.insert(out.end(), literals, literals + literalCount);
+        if (!matchLength) return;
+        out.push_back(static_cast<unsigned char>(offset & 0xFF));
+        out.push_back(static_cast<unsigned char>(offset >> 8));
+        if (matchCode >= 15) writeLength(out, matchCode - 15);
+    }
+
+public:
+    static void compress(const unsigned char* src, size_t size, std::vector<unsigned char>& out) {
+        out.clear();
+        out.reserve(size + size / 255 + 16);
+        size_t anchor = 0;
+
+        if (size > matchLimit) {
+            std::vector<uint32_t> table(size_t(1) << hashBits, 0);   // position + 1, 0 is empty
+            size_t ip = 0;
+            while (ip < size - matchLimit) {
+                uint32_t sequence = read32(src + ip);
+                uint32_t& slot = table[hash(sequence)];
+                size_t candidate = slot;
+                slot = static_cast<uint32_t>(ip + 1);
+
+                if (candidate == 0 || ip - (candidate - 1) > 0xFFFF || read32(src + candidate - 1) != sequence) {
+                    ++ip;
+                    continue;
+                }
+                --candidate;
+                size_t length = minMatch;
+                size_t maxLength = size - lastLiterals - ip;
+                while (length < maxLength && src[candidate + length] == src[ip + length]) ++length;
+
+                writeSequence(out, src + anchor, ip - anchor, ip - candidate, length);
+                ip += length;
+                anchor = ip;
+            }
+        }
+        writeSequence(out, src + anchor, size - anchor, 0, 0);
+    }
+
+    // false if the block is damaged or does not decode to exactly size bytes
+    static bool decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t size) {
+        size_t ip = 0, op = 0;
+        while (ip < srcSize) {
+            unsigned token = src[ip++];
+
+            size_t literalCount = token >> 4;
+            if (literalCount == 15) {
+                unsigned char extra;
+                do {
+                    if (ip >= srcSize) return false;
+                    extra = src[ip++];
+                    literalCount += extra;
+                } while (extra == 255);
+            }
+            if (literalCount > srcSize - ip || literalCount > size - op) return false;
+            std::memcpy(dst + op, src + ip, literalCount);
+            ip += literalCount;
+            op += literalCount;
+            if (ip == srcSize) break;   // the last sequence has no match
+
+            if (srcSize - ip < 2) return false;
+            size_t offset = src[ip] | (static_cast<size_t>(src[ip + 1]) << 8);
+            ip += 2;
+            if (offset == 0 || offset > op) return false;
+
+            size_t matchLength = token & 15;
+            if (matchLength == 15) {
+                unsigned char extra;
+                do {
+                    if (ip >= srcSize) return false;
+                    extra = src[ip++];
+                    matchLength += extra;
+                } while (extra == 255);
+            }
+            matchLength += minMatch;
+            if (matchLength > size - op) return false;
+
+            const unsigned char* match = dst + op - offset;
+            if (offset >= matchLength) {
+                std::memcpy(dst + op, match, matchLength);
+            }
+            else {
+                for (size_t i = 0; i < matchLength; ++i) dst[op + i] = match[i];   // overlapping run
+            }
+            op += matchLength;
+        }
+        return op == size;
+    }
+};
+
+// A read-only file mapping. Every process mapping the same file shares its page cache pages.
+class MappedFile {
+private:
+    const unsigned char* bytes;
+    size_t length;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+
+public:
+    MappedFile() : bytes(nullptr), length(0)
+#ifdef _WIN32
+        , file(INVALID_HANDLE_VALUE), mapping(nullptr)
+#endif
+    {}
+
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false without a message if the file does not exist
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            bytes = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!bytes) {
+            close();
+            return false;
+        }
+        length = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);   // the mapping keeps the file alive
+        if (view == MAP_FAILED) return false;
+        bytes = static_cast<const unsigned char*>(view);
+        length = static_cast<size_t>(info.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (bytes) UnmapViewOfFile(bytes);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes) munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// The bytes of one asset: a view straight into the mapped pack when it is stored
+// uncompressed, otherwise a buffer owned by this object. Valid while the pack stays open.
+class AssetData {
+private:
+    const unsigned char* bytes;
+    size_t length;
+    std::vector<unsigned char> owned;
+
+    friend class AssetPack;
+
+public:
+    AssetData() : bytes(nullptr), length(0) {}
+
+    AssetData(const AssetData&) = delete;
+    AssetData& operator=(const AssetData&) = delete;
+    AssetData(AssetData&&) = default;
+    AssetData& operator=(AssetData&&) = default;
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    std::string str() const { return length ? std::string(reinterpret_cast<const char*>(bytes), length) : std::string(); }
+};
+
+// On-disk layout, little-endian:
+//
+//   PackHeader | PackEntry[entryCount], sorted by id | payloads, each 16-byte aligned
+//
+// An asset is found by the 64-bit FNV-1a hash of its path, with '\' turned into '/'.
+struct PackHeader {
+    char magic[4];          // "PAK1"
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+
+struct PackEntry {
+    uint64_t id;
+    uint64_t offset;        // from the start of the file
+    uint32_t storedSize;
+    uint32_t size;          // after decompression
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+// Every asset the game reads goes through load(): from the mapped pack when one is open and
+// has the asset, otherwise from the file next to the executable. Opening the pack costs the
+// same few system calls whatever it holds; reading from it costs none.
+class AssetPack {
+public:
+    static const uint32_t packVersion = 1;
+    static const uint32_t compressedFlag = 1;
+    static const size_t payloadAlignment = 16;
+
+private:
+    MappedFile file;
+    const PackEntry* entries;
+    uint32_t entryCount;
+    std::string path;
+    std::atomic<size_t> packReads;   // load() runs on the streaming threads too
+    std::atomic<size_t> diskReads;
+
+    AssetPack() : entries(nullptr), entryCount(0), packReads(0), diskReads(0) {}
+
+    const PackEntry* find(uint64_t id) const {
+        const PackEntry* end = entries + entryCount;
+        const PackEntry* it = std::lower_bound(entries, end, id, [](const PackEntry& entry, uint64_t value) {
+            return entry.id < value;
+        });
+        return it != end && it->id == id ? it : nullptr;
+    }
+
+    static bool readFile(const std::string& path, std::vector<unsigned char>& out) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) return false;
+        std::streamoff size = in.tellg();
+        in.seekg(0);
+        out.resize(static_cast<size_t>(size));
+        return size == 0 || static_cast<bool>(in.read(reinterpret_cast<char*>(out.data()), size));
+    }
+
+public:
+    static AssetPack& getInstance() {
+        static AssetPack instance;
+        return instance;
+    }
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    static std::string normalize(const std::string& assetPath) {
+        std::string result = assetPath;
+        std::replace(result.begin(), result.end(), '\\', '/');
+        while (result.compare(0, 2, "./") == 0) result.erase(0, 2);
+        return result;
+    }
+
+    static uint64_t assetId(const std::string& assetPath) {
+        std::string name = normalize(assetPath);
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : name) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Maps packPath; quietly does nothing if it does not exist. A pack that is already
+    // open is replaced, so every AssetData taken from it must be gone by then.
+    bool open(const std::string& packPath) {
+        close();
+        if (!file.open(packPath)) return false;
+
+        const PackHeader* header = reinterpret_cast<const PackHeader*>(file.data());
+        bool valid = file.size() >= sizeof(PackHeader) && std::memcmp(header->magic, "PAK1", 4) == 0 &&
+            header->version == packVersion &&
+            (file.size() - sizeof(PackHeader)) / sizeof(PackEntry) >= header->entryCount;
+        if (valid) {
+            entries = reinterpret_cast<const PackEntry*>(file.data() + sizeof(PackHeader));
+            entryCount = header->entryCount;
+            for (uint32_t i = 0; i < entryCount && valid; ++i) {
+                valid = entries[i].offset <= file.size() && entries[i].storedSize <= file.size() - entries[i].offset &&
+                    (i == 0 || entries[i - 1].id < entries[i].id);
+            }
+        }
+        if (!valid) {
+            std::cerr << "Assets: '" << packPath << "' is not a valid pack, reading loose files" << std::endl;
+            close();
+            return false;
+        }
+        path = packPath;
+        std::cout << "Assets: " << entryCount << " files mapped from " << packPath << std::endl;
+        return true;
+    }
+
+    void close() {
+        file.close();
+        entries = nullptr;
+        entryCount = 0;
+        path.clear();
+    }
+
+    bool isOpen() const { return entries != nullptr; }
+
+    bool contains(const std::string& assetPath) const {
+        return isOpen() && find(assetId(assetPath)) != nullptr;
+    }
+
+    // In the pack or on disk
+    bool exists(const std::string& assetPath) const {
+        return contains(assetPath) || static_cast<bool>(std::ifstream(assetPath, std::ios::binary));
+    }
+
+    // false without a message if the asset is in neither place
+    bool load(const std::string& assetPath, AssetData& out) {
+        const PackEntry* entry = isOpen() ? find(assetId(assetPath)) : nullptr;
+        if (entry) {
+            const unsigned char* stored = file.data() + entry->offset;
+            if (!(entry->flags & compressedFlag)) {
+                out.owned.clear();
+                out.bytes = stored;
+                out.length = entry->size;
+                ++packReads;
+                return true;
+            }
+            out.owned.resize(entry->size);
+            if (LZ4Block::decompress(stored, entry->storedSize, out.owned.data(), entry->size)) {
+                out.bytes = out.owned.data();
+                out.length = entry->size;
+                ++packReads;
+                return true;
+            }
+            std::cerr << "Assets: '" << assetPath << "' is damaged in " << path << ", reading the loose file" << std::endl;
+        }
+
+        if (!readFile(assetPath, out.owned)) return false;
+        out.bytes = out.owned.data();
+        out.length = out.owned.size();
+        ++diskReads;
+        return true;
+    }
+
+    size_t getPackReads() const { return packReads; }
+    size_t getDiskReads() const { return diskReads; }
+};
+
+// Builds a pack from loose files. Text and other compressible assets are stored LZ4
+// compressed; anything that does not shrink by at least an eighth (PNG, JPEG, ...) is
+// stored as is, so loading it is zero-copy.
+class AssetPackWriter {
+private:
+    struct Item {
+        uint64_t id;
+        std::string path;
+        std::vector<unsigned char> stored;
+        uint32_t size;
+        uint32_t flags;
+    };
+
+    std::vector<Item> items;
+    size_t rawBytes = 0;
+    size_t storedBytes = 0;
+
+public:
+    // Always reads the loose file, never an already open pack
+    bool add(const std::string& assetPath) {
+        std::ifstream in(assetPath, std::ios::binary);
+        if (!in) {
+            std::cerr << "Pack: cannot read '" << assetPath << "'" << std::endl;
+            return false;
+        }
+        std::vector<unsigned char> raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        Item item;
+        item.id = AssetPack::assetId(assetPath);
+        item.path = AssetPack::normalize(assetPath);
+        item.size = static_cast<uint32_t>(raw.size());
+        item.flags = 0;
+        LZ4Block::compress(raw.data(), raw.size(), item.stored);
+        if (item.stored.size() <= raw.size() - raw.size() / 8) {
+            item.flags = AssetPack::compressedFlag;
+        }
+        else {
+            item.stored.swap(raw);
+        }
+
+        for (const Item& other : items) {
+            if (other.id == item.id) {
+                if (other.path != item.path) {
+                    std::cerr << "Pack: '" << other.path << "' and '" << item.path << "' have the same id" << std::endl;
+                    return false;
+                }
+                return true;
+            }
+        }
+        rawBytes += item.size;
+        storedBytes += item.stored.size();
+        items.push_back(std::move(item));
+        return true;
+    }
+
+    // Writes next to packPath first and then replaces it, so a running game that has the
+    // old pack mapped never sees a half-written file
+    bool write(const std::string& packPath) {
+        std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.id < b.id; });
+
+        PackHeader header = {};
+        std::memcpy(header.magic, "PAK1", 4);
+        header.version = AssetPack::packVersion;
+        header.entryCount = static_cast<uint32_t>(items.size());
+
+        std::vector<PackEntry> toc(items.size());
+        uint64_t offset = sizeof(PackHeader) + sizeof(PackEntry) * items.size();
+        for (size_t i = 0; i < items.size(); ++i) {
+            offset = (offset + AssetPack::payloadAlignment - 1) / AssetPack::payloadAlignment * AssetPack::payloadAlignment;
+            toc[i] = {};
+            toc[i].id = items[i].id;
+            toc[i].offset = offset;
+            toc[i].storedSize = static_cast<uint32_t>(items[i].stored.size());
+            toc[i].size = items[i].size;
+            toc[i].flags = items[i].flags;
+            offset += items[i].stored.size();
+        }
+
+        const std::string temporary = packPath + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                std::cerr << "Pack: cannot write '" << temporary << "'" << std::endl;
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(toc.data()), sizeof(PackEntry) * toc.size());
+            const char padding[AssetPack::payloadAlignment] = {};
+            uint64_t written = sizeof(PackHeader) + sizeof(PackEntry) * toc.size();
+            for (size_t i = 0; i < items.size(); ++i) {
+                out.write(padding, static_cast<std::streamsize>(toc[i].offset - written));
+                out.write(reinterpret_cast<const char*>(items[i].stored.data()), items[i].stored.size());
+                written = toc[i].offset + items[i].stored.size();
+            }
+            if (!out) {
+                std::cerr << "Pack: failed writing '" << temporary << "'" << std::endl;
+                return false;
+            }
+        }
+#ifdef _WIN32
+        std::remove(packPath.c_str());   // rename does not replace there
+#endif
+        if (std::rename(temporary.c_str(), packPath.c_str()) != 0) {
+            std::cerr << "Pack: cannot replace '" << packPath << "'" << std::endl;
+            return false;
+        }
+        std::cout << "Pack: " << items.size() << " files, " << rawBytes / 1024 << " KB -> "
+            << storedBytes / 1024 << " KB in " << packPath << std::endl;
+        return true;
+    }
+};
+
+#endif // ASSET_PACK_H
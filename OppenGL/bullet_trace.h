@@ -1,122 +1,137 @@
 #ifndef BULLET_TRACE_H
 #define BULLET_TRACE_H
 #include <glad/glad.h>
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include "shader.h"
-#include "stb_image.h"
+#include <vector>
+#include "texture_atlas.h"
+#include "sprite_batch.h"
+#include "render_queue.h"
+#include "camera.h"
 #include <iostream>
 
-class BulletTrace {
+// Every bullet hole on screen lives in one fixed-capacity pool.
+// Traces are stored as parallel arrays and removed by swapping with the last live one,
+// so a hit never allocates and all live traces are drawn with one instanced call.
+class BulletTracePool : public Drawable {
 private:
-    glm::vec2 position;
-    float size;
-    float lifeTime;
-    float maxLifeTime;
-    unsigned int VAO, VBO;
-    unsigned int texture;
-    Shader shader;
-    int screenWidth, screenHeight;
+    int capacity;
+    int liveCount;
+
+    std::vector<float> posX;
+    std::vector<float> posY;
+    std::vector<float> width;
+    std::vector<float> height;
+    std::vector<float> alpha;
+    std::vector<float> age;
+    std::vector<float> lifeTime;
+
+    std::vector<int> visible;   // indices of the traces drawn this frame
+
+    AtlasFrame frame;
+    float pixelAspect;          // on-screen width / height of a world unit, see setView()
+
+    explicit BulletTracePool(int capacity)
+        : capacity(capacity), liveCount(0),
+        posX(capacity), posY(capacity), width(capacity), height(capacity), alpha(capacity),
+        age(capacity), lifeTime(capacity), pixelAspect(1.0f)
+    {
+        frame = TextureAtlas::getInstance().getFrame("texture/bullet_trace.png", TextureFilter::Linear);
+    }
+
+    void kill(int i) {
+        int last = liveCount - 1;
+        posX[i] = posX[last];
+        posY[i] = posY[last];
+        width[i] = width[last];
+        height[i] = height[last];
+        alpha[i] = alpha[last];
+        age[i] = age[last];
+        lifeTime[i] = lifeTime[last];
+        --liveCount;
+    }
 
 public:
-    BulletTrace(float x, float y, float size, float maxLifeTime, const char* texturePath, Shader& shader, int width, int height)
-        : position(x, y), size(size), lifeTime(0.0f), maxLifeTime(maxLifeTime), shader(shader), screenWidth(width), screenHeight(height) {
-        setupMesh();
-        texture = loadTexture(texturePath);
+    static const int defaultCapacity = 8192;
+
+    static BulletTracePool& getInstance() {
+        static BulletTracePool instance(defaultCapacity);
+        return instance;
     }
 
-    void setupMesh() {
-        float vertices[] = {
-            //       //  
-            -size,  size,  0.0f, 0.0f,
-             size,  size,  1.0f, 0.0f,
-             size, -size,  1.0f, 1.0f,
-            -size, -size,  0.0f, 1.0f
-        };
-
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+    BulletTracePool(const BulletTracePool&) = delete;
+    BulletTracePool& operator=(const BulletTracePool&) = delete;
+
+    // The view new traces are shaped for: a world unit covers windowWidth / (2 * halfWidth)
+    // pixels across but windowHeight / (2 * halfHeight) down. Set with the camera every frame.
+    void setView(const Camera2D& camera, int windowWidth, int windowHeight) {
+        if (windowWidth <= 0 || windowHeight <= 0) return;   // minimized: keep the last shape
+        pixelAspect = (static_cast<float>(windowWidth) * camera.getHalfHeight()) /
+            (static_cast<float>(windowHeight) * camera.getHalfWidth());
     }
 
-    unsigned int loadTexture(const char* path) {
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-
-        int width, height, nrComponents;
-        unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-        if (data) {
-            GLenum format;
-            if (nrComponents == 1)
-                format = GL_RED;
-            else if (nrComponents == 3)
-                format = GL_RGB;
-            else if (nrComponents == 4)
-                format = GL_RGBA;
-
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            stbi_image_free(data);
+    // The trace is stretched vertically by the view's pixel aspect so it stays round on screen
+    void spawn(float x, float y, float size, float maxLifeTime) {
+        int i = liveCount;
+        if (liveCount < capacity) {
+            ++liveCount;
         }
         else {
-            std::cout << "Texture failed to load at path: " << path << std::endl;
-            stbi_image_free(data);
+            // Pool is full: the trace closest to fading out makes room
+            i = 0;
+            for (int j = 1; j < liveCount; ++j) {
+                if (lifeTime[j] - age[j] < lifeTime[i] - age[i]) i = j;
+            }
         }
 
-        return textureID;  //  ID 
+        posX[i] = x;
+        posY[i] = y;
+        width[i] = 2 * size;
+        height[i] = 2 * size * pixelAspect;
+        alpha[i] = 1.0f;
+        age[i] = 0.0f;
+        lifeTime[i] = maxLifeTime;
     }
 
     void update(float deltaTime) {
-        lifeTime += deltaTime;
+        for (int i = 0; i < liveCount; ) {
+            age[i] += deltaTime;
+            if (age[i] >= lifeTime[i]) {
+                kill(i);
+                continue;
+            }
+            alpha[i] = 1.0f - age[i] / lifeTime[i];
+            ++i;
+        }
     }
 
-    bool isAlive() const {
-        return lifeTime < maxLifeTime;
+    // Snapshot layout: one SpriteInstance per trace inside the camera view
+    void draw(RenderQueue& queue) {
+        visible.clear();
+        for (int i = 0; i < liveCount; ++i) {
+            float halfWidth = width[i] / 2, halfHeight = height[i] / 2;
+            if (queue.isVisible(posX[i] - halfWidth, posY[i] - halfHeight, posX[i] + halfWidth, posY[i] + halfHeight)) {
+                visible.push_back(i);
+            }
+        }
+        int count = static_cast<int>(visible.size());
+        if (count == 0) return;
+
+        float* data = queue.push(RenderLayer::Decals, this, RenderQueue::spriteProgram, frame.texture.id(),
+            count * sizeof(SpriteInstance) / sizeof(float), count);
+        SpriteInstance* out = reinterpret_cast<SpriteInstance*>(data);
+        for (int j = 0; j < count; ++j) {
+            int i = visible[j];
+            out[j] = SpriteInstance(Sprite(posX[i], posY[i], width[i], height[i], frame.texCoords, 0.0f, alpha[i], frame.shape));
+        }
     }
 
-
-    void draw() {
-        if (!isAlive()) return;
-        shader.Use();
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(position, 0.0f));
-        glUniformMatrix4fv(glGetUniformLocation(shader.Program, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        float alpha = 1.0f - (lifeTime / maxLifeTime);
-        glUniform1f(glGetUniformLocation(shader.Program, "alpha"), alpha);
-
-        float aspectRatio = static_cast<float>(screenWidth) / screenHeight;
-        glUniform1f(glGetUniformLocation(shader.Program, "aspectRatio"), aspectRatio);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-        glBindVertexArray(0); 
+    void render(const float* data, uint32_t count) override {
+        SpriteRenderer::getInstance().draw(frame.texture.id(), reinterpret_cast<const SpriteInstance*>(data), count);
     }
 
-    ~BulletTrace() {
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-    }
+    void clear() { liveCount = 0; }
+
+    int getLiveCount() const { return liveCount; }
+    int getCapacity() const { return capacity; }
 };
 
 #endif
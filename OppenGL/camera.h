@@ -0,0 +1,90 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <algorithm>
+#include <cmath>
+
+// Axis-aligned rectangle in world units
+struct ViewRect {
+    float minX, minY, maxX, maxY;
+
+    bool intersects(float otherMinX, float otherMinY, float otherMaxX, float otherMaxY) const {
+        return otherMaxX >= minX && otherMinX <= maxX && otherMaxY >= minY && otherMinY <= maxY;
+    }
+
+    // Everything is visible: used when nothing set a camera
+    static ViewRect unbounded() {
+        return { -1e30f, -1e30f, 1e30f, 1e30f };
+    }
+};
+
+// 2D camera over world space. World units match the old NDC layout: a camera at (0, 0)
+// with the default half extents of 1 shows exactly what the levels drew before,
+// so levels keep their coordinates and can now grow past one screen.
+//
+// The view-projection is a scale and a translation, passed to the shaders as
+// vec4(scale.xy, offset.xy): clip = world * scale + offset.
+class Camera2D {
+private:
+    float x, y;
+    float halfWidth, halfHeight;
+    float boundsMinX, boundsMinY, boundsMaxX, boundsMaxY;
+    float followRate;   // 1/s, how fast the camera closes the gap to its target
+
+    void clampToBounds() {
+        // A level narrower than the view keeps the camera on its centre
+        if (boundsMaxX - boundsMinX <= 2 * halfWidth) x = (boundsMinX + boundsMaxX) / 2;
+        else x = std::min(std::max(x, boundsMinX + halfWidth), boundsMaxX - halfWidth);
+        if (boundsMaxY - boundsMinY <= 2 * halfHeight) y = (boundsMinY + boundsMaxY) / 2;
+        else y = std::min(std::max(y, boundsMinY + halfHeight), boundsMaxY - halfHeight);
+    }
+
+public:
+    Camera2D(float halfWidth = 1.0f, float halfHeight = 1.0f)
+        : x(0.0f), y(0.0f), halfWidth(halfWidth), halfHeight(halfHeight),
+        boundsMinX(-1e30f), boundsMinY(-1e30f), boundsMaxX(1e30f), boundsMaxY(1e30f), followRate(5.0f) {}
+
+    // The world rectangle the camera may show
+    void setBounds(float minX, float minY, float maxX, float maxY) {
+        boundsMinX = minX;
+        boundsMinY = minY;
+        boundsMaxX = maxX;
+        boundsMaxY = maxY;
+        clampToBounds();
+    }
+
+    void setFollowRate(float rate) { followRate = rate; }
+
+    void snapTo(float targetX, float targetY) {
+        x = targetX;
+        y = targetY;
+        clampToBounds();
+    }
+
+    // Eases towards the target independently of the frame rate
+    void follow(float targetX, float targetY, float deltaTime) {
+        float t = 1.0f - std::exp(-followRate * deltaTime);
+        x += (targetX - x) * t;
+        y += (targetY - y) * t;
+        clampToBounds();
+    }
+
+    float getX() const { return x; }
+    float getY() const { return y; }
+    float getHalfWidth() const { return halfWidth; }
+    float getHalfHeight() const { return halfHeight; }
+
+    void getViewProjection(float out[4]) const {
+        out[0] = 1.0f / halfWidth;
+        out[1] = 1.0f / halfHeight;
+        out[2] = -x / halfWidth;
+        out[3] = -y / halfHeight;
+    }
+
+    // What the camera sees, grown by margin on every side
+    ViewRect getViewRect(float margin = 0.0f) const {
+        return { x - halfWidth - margin, y - halfHeight - margin, x + halfWidth + margin, y + halfHeight + margin };
+    }
+};
+
+#endif // CAMERA_H
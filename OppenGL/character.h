@@ -9,27 +9,19 @@
 #include <sstream> 
 #include <iostream> 
 
-#include "shader.h"
-#include "stb_image.h"
+#include "render_queue.h"
+#include "animation.h"
 #include "collide.h"
 
-#include <GLFW/glfw3.h>
+#include "input.h"
 
 class Character;
 
-struct Vec4 {
-    float x, y, z, w;
-    Vec4(float x = 0.0f, float y = 0.0f, float z = 0.0f, float w = 0.0f) : x(x), y(y), z(z), w(w) {}
-};
-
 class Character {
 private:
     float x, y;
     float speed;
     float width, height;
-    unsigned int VAO, VBO, EBO;
-    unsigned int texture1, texture2;
-    Shader shader;
     std::vector<Collide*> collideObjects;
 
     float verticalVelocity;
@@ -40,10 +32,7 @@ private:
     float characterWidth = 0.2f;  //     
     float characterHeight = 0.55f; //      
 
-    std::vector<Vec4> frames;  // Texture coordinates for each frame
-    int currentFrame;
-    float frameTime;
-    float timeSinceLastFrame;
+    Animator::Handle animation;  // Walk cycle, advanced by the Animator
     bool isMoving;
     bool facingRight;
 
@@ -52,78 +41,25 @@ private:
     float timeSinceLastHit;
     bool isAlive;
 
-    unsigned int loadTexture(const char* path) {
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-
-
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); 
-
-        int width, height, nrChannels;
-        unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 4);
-
-        if (data) {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            int framesPerRow = 4;  // Adjust based on your spritesheet
-            int framesPerColumn = 4;
-            float frameWidth = 1.0f / framesPerRow;
-            float frameHeight = 1.0f / framesPerColumn;
-
-            for (int y = 0; y < framesPerColumn; ++y) {
-                for (int x = 0; x < framesPerRow; ++x) {
-                    frames.push_back(Vec4(
-                        x * frameWidth, y * frameHeight,
-                        (x + 1) * frameWidth, (y + 1) * frameHeight
-                    ));
-                }
-            }
-        }
-        else {
-            std::cout << "Failed to load texture" << std::endl;
-        }
-        stbi_image_free(data);
-        return textureID;
-    }
-
-    void calculateTextureCoords() {
-        int framesPerRow = 4;
-        int framesPerColumn = 2;  //   2,     2  
-        float frameWidth = 1.0f / framesPerRow;
-        float frameHeight = 1.0f / framesPerColumn;
-
-        frames.clear();
-        for (int y = 0; y < framesPerColumn; ++y) {
-            for (int x = 0; x < framesPerRow; ++x) {
-                frames.push_back(Vec4(
-                    x * frameWidth,
-                    1.0f - (y + 1) * frameHeight,  //  Y-
-                    (x + 1) * frameWidth,
-                    1.0f - y * frameHeight  //  Y-
-                ));
-            }
-        }
-    }
 
 
 public:
     Character(float startX, float startY, float characterWidth, float characterHeight, float moveSpeed,
-        const char* vertexPath, const char* fragmentPath,
         const char* texturePath)
         : x(startX), y(startY), width(characterWidth), height(characterHeight), speed(moveSpeed),
-        shader(vertexPath, fragmentPath), verticalVelocity(0.0f), isOnGround(false),
-        currentFrame(0), frameTime(0.07f), timeSinceLastFrame(0.0f), isMoving(false), facingRight(true),
+        verticalVelocity(0.0f), isOnGround(false),
+        animation(Animator::invalidHandle), isMoving(false), facingRight(true),
         hp(50), invincibilityTime(1.0f), timeSinceLastHit(0.0f), isAlive(true) //   ; hp = 100
     {
-        setupMesh();
-        texture1 = loadTexture(texturePath);
-        calculateTextureCoords();
+        animation = Animator::getInstance().create(
+            AnimationLibrary::getInstance().getClip(texturePath, 4, 2, TextureFilter::Nearest, 0.07f));
+    }
+
+    Character(const Character&) = delete;
+    Character& operator=(const Character&) = delete;
+
+    ~Character() {
+        Animator::getInstance().destroy(animation);
     }
 
     void setPosition(float x, float y) {
@@ -151,19 +87,6 @@ public:
 
 
 
-    void updateAnimation(float deltaTime) {
-        if (isMoving) {
-            timeSinceLastFrame += deltaTime;
-            if (timeSinceLastFrame >= frameTime) {
-                currentFrame = (currentFrame + 1) % 8;  // ,    8  
-                timeSinceLastFrame = 0.0f;
-            }
-        }
-        else {
-            currentFrame = 0;  //  
-        }
-    }
-
     void addCollideObject(Collide* obj) {
         collideObjects.push_back(obj);
     }
@@ -185,43 +108,6 @@ public:
 
 
 
-    void setupMesh() {
-        float vertices[] = {
-            // Positions                                // Colors           // Texture Coords
-             characterWidth / 2,  characterHeight / 2, 0.0f, 1.0f, 0.0f, 0.0f,   1.0f, 0.0f, // Top Right
-             characterWidth / 2, -characterHeight / 2, 0.0f, 0.0f, 1.0f, 0.0f,   1.0f, 1.0f, // Bottom Right
-            -characterWidth / 2, -characterHeight / 2, 0.0f, 0.0f, 0.0f, 1.0f,   0.0f, 1.0f, // Bottom Left
-            -characterWidth / 2,  characterHeight / 2, 0.0f, 1.0f, 1.0f, 0.0f,   0.0f, 0.0f  // Top Left 
-        };
-
-        unsigned int indices[] = {
-            0, 1, 3,
-            1, 2, 3
-        };
-
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-    }
-
     float getX() const { return x; }
     float getY() const { return y; }
 
@@ -268,7 +154,7 @@ public:
         if (dx > 0) facingRight = true; 
         else if (dx < 0) facingRight = false; 
 
-        updateAnimation(deltaTime); 
+        Animator::getInstance().setPlaying(animation, isMoving);
     }
 
 
@@ -284,43 +170,29 @@ public:
         // ...  ,   ...
     }
 
-    void draw(GLFWwindow* window, float deltaTime) {
-
-        shader.Use();
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        shader.setInt("ourTexture1", 0);
-
-        Vec4 texCoords = frames[currentFrame];
+    void draw(RenderQueue& queue) {
+        const AtlasFrame& frame = Animator::getInstance().getFrame(animation);
+        Vec4 texCoords = frame.texCoords;
         if (!facingRight) {
             std::swap(texCoords.x, texCoords.z);
         }
 
-        glUniform1f(glGetUniformLocation(shader.Program, "y_mov"), y);
-        glUniform1f(glGetUniformLocation(shader.Program, "x_mov"), x);
-
-        shader.setVec4("texCoords", texCoords.x, texCoords.y, texCoords.z, texCoords.w);
-
-
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        queue.push(RenderLayer::World, frame.texture.id(), Sprite(x, y, characterWidth, characterHeight, texCoords, 0.0f, 1.0f, frame.shape));
     }
     float dx = 0;
 
-    void processInput(GLFWwindow* window, float deltaTime) {
+    void processInput(const Input& input, float deltaTime) {
         dx = 0;
 
         //std::cout << "X: " << x << ";      Y:" << y << std::endl;
          
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) { 
+        if (input.isKeyDown(GLFW_KEY_A)) { 
             dx -= 1.0f;
         }
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) { 
+        if (input.isKeyDown(GLFW_KEY_D)) { 
             dx += 1.0f;
         }
-        if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+        if (input.isKeyDown(GLFW_KEY_SPACE)) {
             jump();
         }
 
@@ -328,12 +200,6 @@ public:
     }
     float getDX() const { return dx; }
 
-    ~Character() {
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-        glDeleteBuffers(1, &EBO);
-    }
-
 
 
 
@@ -9,8 +9,7 @@
 #include <sstream> 
 #include <iostream> 
 
-#include "shader.h"
-#include "stb_image.h"
+#include "texture_atlas.h"
 
 #include <GLFW/glfw3.h> 
 
@@ -19,43 +18,7 @@ private:
     float x, y;
     float speed;
     float width, height;
-    unsigned int VAO, VBO, EBO;
-    unsigned int texture1;
-    Shader shader;
-
-    unsigned int loadTexture(const char* path) {
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-
-        int width, height, nrComponents;
-        unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-        if (data) {
-            GLenum format;
-            if (nrComponents == 1)
-                format = GL_RED;
-            else if (nrComponents == 3)
-                format = GL_RGB;
-            else if (nrComponents == 4)
-                format = GL_RGBA;
-
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            stbi_image_free(data);
-        }
-        else {
-            std::cout << "Texture failed to load at path: " << path << std::endl;
-            stbi_image_free(data);
-        }
-
-        return textureID;
-    }
+    AtlasFrame frame;
 
 
 public:
@@ -63,73 +26,16 @@ public:
     float getY() { return y; }
     float getWidth() { return width; }
     float getHeight() { return height; }
+    const AtlasFrame& getFrame() const { return frame; }
 
     Collide(float startX, float startY, float characterWidth, float characterHeight, float moveSpeed,
-        const char* vertexPath, const char* fragmentPath, const char* texturePath)
-        : x(startX), y(startY), width(characterWidth), height(characterHeight), speed(moveSpeed),
-        shader(vertexPath, fragmentPath)
+        const char* texturePath)
+        : x(startX), y(startY), width(characterWidth), height(characterHeight), speed(moveSpeed)
     {
-        setupMesh();
-        texture1 = loadTexture(texturePath);
+        frame = TextureAtlas::getInstance().getFrame(texturePath, TextureFilter::Linear);
     }
 
-    void setupMesh() {
-        float vertices[] = {
-            // Positions                   // Colors           // Texture Coords
-             width / 2,  height / 2, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f, // Top Right
-             width / 2, -height / 2, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f, // Bottom Right
-            -width / 2, -height / 2, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f, // Bottom Left
-            -width / 2,  height / 2, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f  // Top Left 
-        };
-
-        unsigned int indices[] = {
-            0, 1, 3,
-            1, 2, 3
-        };
-
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-    }
-
-    void draw() {
-        shader.Use();
-        glUniform1f(glGetUniformLocation(shader.Program, "x_mov_full"), x);
-        glUniform1f(glGetUniformLocation(shader.Program, "y_mov_full"), y);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glUniform1i(glGetUniformLocation(shader.Program, "texture1"), 0);
-
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-    }
-
-    ~Collide() {
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-        glDeleteBuffers(1, &EBO);
-        glDeleteTextures(1, &texture1);
-    }
+    // Colliders are static: LevelGeometry bakes and draws them
 };
 
 
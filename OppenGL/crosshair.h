@@ -2,59 +2,38 @@
 #define CROSSHAIR_H
 
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
-#include "shader.h"
+#include "input.h"
+#include "render_queue.h"
 
+// Two one-pixel bars drawn as untextured screen-space sprites, so the crosshair goes
+// through the sprite program like everything else
 class Crosshair {
 private:
-    unsigned int VAO, VBO;
-    Shader shader;
     float size;
 
 public:
-    Crosshair(float crosshairSize = 0.03f)
-        : shader("vertex_crosshair.glsl", "fragment_crosshair.glsl"), size(crosshairSize) {
-        float vertices[] = {
-            //  
-            -size,  0.0f, 0.0f,
-             size,  0.0f, 0.0f,
-             //  
-              0.0f, -size - 0.03f, 0.0f,
-              0.0f,  size + 0.03f, 0.0f
-        };
+    Crosshair(float crosshairSize = 0.03f) : size(crosshairSize) {}
 
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-    }
-
-    void draw(GLFWwindow* window) {
+    void draw(RenderQueue& queue, const Input& input) {
         double xpos, ypos;
-        glfwGetCursorPos(window, &xpos, &ypos);
+        input.getCursorPos(&xpos, &ypos);
 
         //      OpenGL
         int width, height;
-        glfwGetWindowSize(window, &width, &height);
-        float normalizedX = (2.0f * xpos) / width - 1.0f;
-        float normalizedY = 1.0f - (2.0f * ypos) / height;
-
-        shader.Use();
-        glUniform2f(glGetUniformLocation(shader.Program, "crosshairPosition"), normalizedX, normalizedY);
-        glUniform3f(glGetUniformLocation(shader.Program, "crosshairColor"), 1.0f, 0.0f, 0.0f); //  
-
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_LINES, 0, 4);
-    }
-
-    ~Crosshair() {
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
+        input.getWindowSize(&width, &height);
+        float x = (2.0f * xpos) / width - 1.0f;
+        float y = 1.0f - (2.0f * ypos) / height;
+        float pixelWidth = 2.0f / width, pixelHeight = 2.0f / height;
+
+        //  
+        Sprite horizontal(x, y, 2 * size, pixelHeight, Vec4());
+        //  
+        Sprite vertical(x, y, pixelWidth, 2 * (size + 0.03f), Vec4());
+        for (Sprite* bar : { &horizontal, &vertical }) {
+            bar->flags = SpriteFlag::ScreenSpace | SpriteFlag::Untextured;
+            bar->g = bar->b = 0.0f; //  
+            queue.push(RenderLayer::Overlay, 0, *bar);
+        }
     }
 };
 
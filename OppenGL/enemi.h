@@ -9,27 +9,24 @@
 #include <sstream> 
 #include <iostream> 
 
-#include "shader.h"
-#include "stb_image.h"
+#include "render_queue.h"
+#include "animation.h"
 #include "collide.h"
 #include "character.h"
 #include "bullet_trace.h"
 #include "particle_emitter.h"
 
-#include <GLFW/glfw3.h>
+#include "input.h"
 
 
 class Enemi {
 protected:
-    unsigned int VAO, VBO, EBO;
-
-    virtual void setupMesh();
+    float characterWidth = 0.25f;  //     
+    float characterHeight = 0.25f; //     
 
 private:
     float speed;
     float width, height;
-    unsigned int texture1, texture2;
-    Shader shader;
     std::vector<Collide*> collideObjects;
 
     float verticalVelocity;
@@ -37,13 +34,7 @@ private:
     const float jumpStrength = 3.0f;
     bool isOnGround;
 
-    float characterWidth = 0.25f;  //     
-    float characterHeight = 0.25f; //     
-
-    std::vector<Vec4> frames;  // Texture coordinates for each frame
-    int currentFrame;
-    float frameTime;
-    float timeSinceLastFrame;
+    Animator::Handle animation;  // Walk cycle, advanced by the Animator
     bool isMoving;
     bool facingRight;
 
@@ -56,67 +47,7 @@ private:
     float timeSinceLastAttack;
     int damage;
 
-    std::vector<BulletTrace> bulletTraces;
-    Shader bulletTraceShader;
-
-    unsigned int loadTexture(const char* path) {
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-
-
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-        int width, height, nrChannels;
-        unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 4);
-
-        if (data) {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            int framesPerRow = 4;  // Adjust based on your spritesheet
-            int framesPerColumn = 4;
-            float frameWidth = 1.0f / framesPerRow;
-            float frameHeight = 1.0f / framesPerColumn;
-
-            for (int y = 0; y < framesPerColumn; ++y) {
-                for (int x = 0; x < framesPerRow; ++x) {
-                    frames.push_back(Vec4(
-                        x * frameWidth, y * frameHeight,
-                        (x + 1) * frameWidth, (y + 1) * frameHeight
-                    ));
-                }
-            }
-        }
-        else {
-            std::cout << "Failed to load texture" << std::endl;
-        }
-        stbi_image_free(data);
-        return textureID;
-    }
 
-    void calculateTextureCoords() {
-        int framesPerRow = 4;
-        int framesPerColumn = 2;  //   2,     2  
-        float frameWidth = 1.0f / framesPerRow;
-        float frameHeight = 1.0f / framesPerColumn;
-
-        frames.clear();
-        for (int y = 0; y < framesPerColumn; ++y) {
-            for (int x = 0; x < framesPerRow; ++x) {
-                frames.push_back(Vec4(
-                    x * frameWidth,
-                    1.0f - (y + 1) * frameHeight,  //  Y-
-                    (x + 1) * frameWidth,
-                    1.0f - y * frameHeight  //  Y-
-                ));
-            }
-        }
-    }
     
 
 
@@ -125,34 +56,24 @@ public:
     Character* character;
 
     Enemi(float startX, float startY, float characterWidth, float characterHeight, float moveSpeed, int hp,
-        const char* vertexPath, const char* fragmentPath,
-        const char* texturePath,
-        const char* bulletTraceVertexPath, const char* bulletTraceFragmentPath)
+        const char* texturePath)
         : x(startX), y(startY), width(characterWidth), height(characterHeight), speed(moveSpeed),
-        shader(vertexPath, fragmentPath), bulletTraceShader(bulletTraceVertexPath, bulletTraceFragmentPath),
-        timeSinceLastFrame(0.0f), isMoving(false), facingRight(true),
+        animation(Animator::invalidHandle), isMoving(false), facingRight(true),
         quadLeft(-width / 2), quadRight(width / 2), quadTop(height / 2), quadBottom(-height / 2),
         hp(hp), isAlive(true), attackCooldown(1.0f), timeSinceLastAttack(0.0f), damage(10)
     {
-        setupMesh();
-        texture1 = loadTexture(texturePath);
-        calculateTextureCoords();
+        animation = Animator::getInstance().create(
+            AnimationLibrary::getInstance().getClip(texturePath, 4, 2, TextureFilter::Nearest, 0.07f));
     }
 
+    Enemi(const Enemi&) = delete;
+    Enemi& operator=(const Enemi&) = delete;
 
-    void updateAnimation(float deltaTime) {
-        if (isMoving) {
-            timeSinceLastFrame += deltaTime;
-            if (timeSinceLastFrame >= frameTime) {
-                currentFrame = (currentFrame + 1) % 8;  // ,    8  
-                timeSinceLastFrame = 0.0f;
-            }
-        }
-        else {
-            currentFrame = 0;  //  
-        }
+    ~Enemi() {
+        Animator::getInstance().destroy(animation);
     }
 
+
     void addCollideObject(Collide* obj) {
         collideObjects.push_back(obj);
     }
@@ -161,16 +82,12 @@ public:
         character = obj;
     }
 
-    void handleMouseClick(GLFWwindow* window, int button, int action, int mods) {
+    void handleMouseClick(const Input& input, int button, int action, int mods) {
         if (!isAlive) return;
 
         if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-            double xpos, ypos;
-            glfwGetCursorPos(window, &xpos, &ypos);
-            int width, height;
-            glfwGetWindowSize(window, &width, &height);
-            float clickX = (2.0f * xpos) / width - 1.0f;
-            float clickY = 1.0f - (2.0f * ypos) / height;
+            float clickX, clickY;
+            input.getCursorWorld(&clickX, &clickY);
 
             // Adjust click coordinates based on enemy position
             clickX -= x;
@@ -181,7 +98,7 @@ public:
                 // Hit detected, create a bullet trace
                 float traceX = x + clickX;  // Convert to world coordinates
                 float traceY = y + clickY;
-                bulletTraces.emplace_back(traceX, traceY, 0.05f, 1.0f, "texture/bullet_trace.png", bulletTraceShader, width, height);
+                BulletTracePool::getInstance().spawn(traceX, traceY, 0.05f, 1.0f);
                 hp -= 5;
                 std::cout << "Enemy hit! HP: " << hp << std::endl;
                 if (hp <= 0) {
@@ -192,19 +109,6 @@ public:
         }
     }
 
-    void updateAndDrawBulletTraces(float deltaTime) {
-        for (auto it = bulletTraces.begin(); it != bulletTraces.end();) {
-            it->update(deltaTime);
-            if (it->isAlive()) {
-                it->draw();
-                ++it;
-            }
-            else {
-                it = bulletTraces.erase(it);
-            }
-        }
-    }
-
 
     bool getIsAlive() const { return isAlive; }
     bool isColliding(float newX, float newY) {
@@ -300,7 +204,7 @@ public:
         if (dx > 0) facingRight = true;
         else if (dx < 0) facingRight = false;
 
-        updateAnimation(deltaTime);
+        Animator::getInstance().setPlaying(animation, isMoving);
     }
 
 
@@ -317,38 +221,21 @@ public:
     }
 
 
-    void draw(float deltaTime) {
-
-        shader.Use();
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1 );
-        shader.setInt("ourTexture1", 0);
-
-        Vec4 texCoords = frames[currentFrame];
+    void draw(RenderQueue& queue) {
+        const AtlasFrame& frame = Animator::getInstance().getFrame(animation);
+        Vec4 texCoords = frame.texCoords;
         if (!facingRight) {
             std::swap(texCoords.x, texCoords.z);
         }
 
-
-        glUniform1f(glGetUniformLocation(shader.Program, "y_mov"), y);
-        glUniform1f(glGetUniformLocation(shader.Program, "x_mov"), x);
-
-        shader.setVec4("texCoords", texCoords.x, texCoords.y, texCoords.z, texCoords.w);
-
-
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        updateAndDrawBulletTraces(deltaTime);
+        queue.push(RenderLayer::World, frame.texture.id(), Sprite(x, y, characterWidth, characterHeight, texCoords, 0.0f, 1.0f, frame.shape));
     }
 
     void make_dead() {
         isAlive = false;
     }
 
-    void processInput(GLFWwindow* window, float deltaTime) {
+    void processInput(const Input& input, float deltaTime) {
         float dx = 0;
         float dy = 0;
 
@@ -377,105 +264,24 @@ public:
         attackPlayer();
     }
 
-    ~Enemi() {
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-        glDeleteBuffers(1, &EBO);
-    }
-
 
 };
 
-void Enemi::setupMesh() {
-    float vertices[] = {
-        // Positions                                // Colors           // Texture Coords
-         characterWidth / 2,  characterHeight / 2, 0.0f, 1.0f, 0.0f, 0.0f,   1.0f, 0.0f, // Top Right
-         characterWidth / 2, -characterHeight / 2, 0.0f, 0.0f, 1.0f, 0.0f,   1.0f, 1.0f, // Bottom Right
-        -characterWidth / 2, -characterHeight / 2, 0.0f, 0.0f, 0.0f, 1.0f,   0.0f, 1.0f, // Bottom Left
-        -characterWidth / 2,  characterHeight / 2, 0.0f, 1.0f, 1.0f, 0.0f,   0.0f, 0.0f  // Top Left 
-    };
-
-    unsigned int indices[] = {
-        0, 1, 3,
-        1, 2, 3
-    };
-
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-}
-
 class Boss : public Enemi {
 private:
 
     static constexpr float bossCharacterWidth = 0.50f;  //     
     static constexpr float bossCharacterHeight = 0.50f; //     
 
-    void setupMesh() override {
-        float vertices[] = {
-            // Positions                                // Colors           // Texture Coords
-             bossCharacterWidth / 2,  bossCharacterHeight / 2, 0.0f, 1.0f, 0.0f, 0.0f,   1.0f, 0.0f, // Top Right
-             bossCharacterWidth / 2, -bossCharacterHeight / 2, 0.0f, 0.0f, 1.0f, 0.0f,   1.0f, 1.0f, // Bottom Right
-            -bossCharacterWidth / 2, -bossCharacterHeight / 2, 0.0f, 0.0f, 0.0f, 1.0f,   0.0f, 1.0f, // Bottom Left
-            -bossCharacterWidth / 2,  bossCharacterHeight / 2, 0.0f, 1.0f, 1.0f, 0.0f,   0.0f, 0.0f  // Top Left 
-        };
-
-        unsigned int indices[] = {
-            0, 1, 3,
-            1, 2, 3
-        };
-
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-    }
-
 public:
     Boss(float startX, float startY, float characterWidth, float characterHeight, float moveSpeed, int hp,
-        const char* vertexPath, const char* fragmentPath,
-        const char* texturePath, const char* bulletTraceVertexPath, const char* bulletTraceFragmentPath,
+        const char* texturePath,
         float screenWidth, float screenHeight)
         :
-        Enemi(startX, startY, characterWidth, characterHeight, moveSpeed, hp,
-            vertexPath, fragmentPath, texturePath, bulletTraceVertexPath, bulletTraceFragmentPath)
+        Enemi(startX, startY, characterWidth, characterHeight, moveSpeed, hp, texturePath)
       {
-        setupMesh();
+        this->characterWidth = bossCharacterWidth;
+        this->characterHeight = bossCharacterHeight;
       }
 
 
@@ -1,15 +0,0 @@
-#version 330 core
-out vec4 FragColor;
-
-in vec2 TexCoord;
-
-uniform sampler2D texture1;
-uniform float alpha;
-
-void main()
-{
-    vec4 texColor = texture(texture1, TexCoord);
-    if(texColor.a < 0.1)
-        discard;
-    FragColor = vec4(texColor.rgb, texColor.a * alpha);
-}
\ No newline at end of file
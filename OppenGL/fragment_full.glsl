@@ -1,17 +0,0 @@
-#version 330 core
-out vec4 FragColor;
-
-in vec3 ourColor;
-in vec2 TexCoord;
-
-uniform sampler2D ourTexture1;
-
-void main()
-{
-    vec4 texColor = texture(ourTexture1, TexCoord);
-    
-    if(texColor.a < 0.1)
-        discard;
-    
-    FragColor = texColor;
-}
\ No newline at end of file
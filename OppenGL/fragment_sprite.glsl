@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec4 ourColor;
+flat in int untextured;
+
+uniform sampler2D ourTexture1;
+uniform int overdraw;   // 1: add a fixed step for every shaded fragment, discarded ones included
+
+void main()
+{
+    if (overdraw != 0) {
+        FragColor = vec4(0.1, 0.04, 0.01, 1.0);
+        return;
+    }
+
+    vec4 texColor = untextured != 0 ? vec4(1.0) : texture(ourTexture1, TexCoord);
+
+    if(texColor.a < 0.1)
+        discard;
+
+    FragColor = texColor * ourColor;
+}
\ No newline at end of file
@@ -0,0 +1,448 @@
+#ifndef GL_BACKEND_H
+#define GL_BACKEND_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "render_backend.h"
+#include "gl_state.h"
+#include "stream_buffer.h"
+#include "texture_compress.h"
+
+// The OpenGL implementation. Every call expects the context to be current on the calling
+// thread, which for the game is the render thread.
+class GLBackend : public RenderBackend {
+private:
+    // Created on first use so it is allocated on the thread that owns the context
+    std::unique_ptr<StreamBuffer> stream;
+    mutable std::vector<GLint> compressedFormats;   // queried on first use
+    GLuint pixelBuffer = 0;                          // staging for createTextureStreamed
+
+    // Program binaries and parallel compiles are GL 4.1 / extension features, looked up on first use
+    struct ProgramFeatures {
+        bool queried = false;
+        PFNGLGETPROGRAMBINARYPROC getProgramBinary = nullptr;
+        PFNGLPROGRAMBINARYPROC programBinary = nullptr;
+        PFNGLPROGRAMPARAMETERIPROC programParameteri = nullptr;
+    };
+    ProgramFeatures programFeatures;
+
+
+    StreamBuffer& getStream() {
+        if (!stream) stream.reset(new StreamBuffer());
+        return *stream;
+    }
+
+    // glad is generated for core 3.3 without extensions; the rest is loaded by hand
+    const ProgramFeatures& getProgramFeatures() {
+        ProgramFeatures& features = programFeatures;
+        if (features.queried) return features;
+        features.queried = true;
+
+        if (GLAD_GL_VERSION_4_1 && glGetProgramBinary) {
+            features.getProgramBinary = glGetProgramBinary;
+            features.programBinary = glProgramBinary;
+            features.programParameteri = glProgramParameteri;
+        }
+        else if (StreamBuffer::hasExtension("GL_ARB_get_program_binary")) {
+            features.getProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYPROC>(glfwGetProcAddress("glGetProgramBinary"));
+            features.programBinary = reinterpret_cast<PFNGLPROGRAMBINARYPROC>(glfwGetProcAddress("glProgramBinary"));
+            features.programParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC>(glfwGetProcAddress("glProgramParameteri"));
+        }
+        // Some drivers expose the calls but no format to save in
+        GLint formats = 0;
+        if (features.getProgramBinary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats == 0 || !features.programBinary || !features.programParameteri) {
+            features.getProgramBinary = nullptr;
+            features.programBinary = nullptr;
+            features.programParameteri = nullptr;
+        }
+
+        typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+        MaxShaderCompilerThreadsProc maxThreads = nullptr;
+        if (StreamBuffer::hasExtension("GL_KHR_parallel_shader_compile")) {
+            maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        }
+        else if (StreamBuffer::hasExtension("GL_ARB_parallel_shader_compile")) {
+            maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
+        }
+        // Compiles begun by beginProgram() now run on as many threads as the driver likes
+        if (maxThreads) maxThreads(0xFFFFFFFFu);
+        return features;
+    }
+
+    static GLuint startStage(GLenum stage, const std::string& source) {
+        const GLchar* code = source.c_str();
+        GLuint shader = glCreateShader(stage);
+        glShaderSource(shader, 1, &code, NULL);
+        glCompileShader(shader);
+        return shader;
+    }
+
+    // Blocks until the driver is done with the stage
+    static bool checkStage(GLuint shader, const char* stageName) {
+        GLint success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            GLchar infoLog[512];
+            glGetShaderInfoLog(shader, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::" << stageName << "::COMPILETION_FAILED\n" << infoLog << std::endl;
+        }
+        return success != 0;
+    }
+
+    static void reflectUniforms(GLuint program, std::vector<UniformDesc>& uniforms) {
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::string name(maxLength > 0 ? maxLength : 1, '\0');
+        for (GLint i = 0; i < count; ++i) {
+            GLsizei length = 0;
+            UniformDesc desc;
+            glGetActiveUniform(program, i, maxLength, &length, &desc.size, &desc.type, &name[0]);
+
+            desc.name.assign(name.c_str(), length);
+            // Arrays are reported as "name[0]", look them up by the plain name
+            if (desc.name.size() > 3 && desc.name.compare(desc.name.size() - 3, 3, "[0]") == 0) {
+                desc.name.erase(desc.name.size() - 3);
+            }
+
+            desc.location = glGetUniformLocation(program, desc.name.c_str());
+            if (desc.location != -1) {
+                uniforms.push_back(desc);
+            }
+        }
+    }
+
+    static GLenum pixelFormat(int channels) {
+        if (channels == 1) return GL_RED;
+        if (channels == 3) return GL_RGB;
+        return GL_RGBA;
+    }
+
+    static void setSampling(const TextureDesc& desc, bool mipmapped) {
+        GLint wrap = desc.clampToEdge ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        if (desc.filter == TextureFilter::Nearest) {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        else {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+    }
+
+public:
+    const char* getName() const override { return "opengl"; }
+
+    int getMaxTextureSize() const override {
+        GLint size = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &size);
+        return size;
+    }
+
+    unsigned int createTexture(const TextureDesc& desc, const unsigned char* pixels) override {
+        unsigned int id;
+        glGenTextures(1, &id);
+
+        GLenum format = pixelFormat(desc.channels);
+        GLState::getInstance().bindTexture(0, id);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, desc.width, desc.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+        if (desc.mipmaps) glGenerateMipmap(GL_TEXTURE_2D);
+        setSampling(desc, desc.mipmaps);
+        return id;
+    }
+
+    // The pixels go into a pixel unpack buffer and glTexImage2D reads from there, so the
+    // driver can finish the transfer asynchronously instead of copying before it returns.
+    // The buffer is orphaned for every upload: the previous one may still be reading it.
+    unsigned int createTextureStreamed(const TextureDesc& desc, const unsigned char* pixels) override {
+        size_t bytes = static_cast<size_t>(desc.width) * desc.height * desc.channels;
+        if (!pixelBuffer) glGenBuffers(1, &pixelBuffer);
+
+        GLState& gl = GLState::getInstance();
+        gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        unsigned int id = 0;
+        if (staging) {
+            std::memcpy(staging, pixels, bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            id = createTexture(desc, nullptr);   // offset 0 into the bound unpack buffer
+        }
+        gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return staging ? id : createTexture(desc, pixels);
+    }
+
+    // Staged through the same unpack buffer as createTextureStreamed, one band at a time
+    void updateTextureRows(unsigned int id, const TextureDesc& desc, int y, int rows, const unsigned char* pixels) override {
+        size_t bytes = static_cast<size_t>(desc.width) * rows * desc.channels;
+        if (!pixelBuffer) glGenBuffers(1, &pixelBuffer);
+
+        GLState& gl = GLState::getInstance();
+        gl.bindTexture(0, id);
+        gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (staging) {
+            std::memcpy(staging, pixels, bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            pixels = nullptr;   // offset 0 into the bound unpack buffer
+        }
+        else {
+            gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, desc.width, rows, pixelFormat(desc.channels), GL_UNSIGNED_BYTE, pixels);
+        gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (desc.mipmaps && y + rows == desc.height) glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    unsigned int createCompressedTexture(const TextureDesc& desc, const CompressedImage& image) override {
+        if (!supportsCompressedFormat(image.format)) {
+            // The driver cannot sample it: expand level 0 and let GL build the mips
+            TextureDesc expanded = desc;
+            std::vector<unsigned char> pixels = TextureCompressor::decompress(image, 0, expanded.width, expanded.height);
+            expanded.channels = 4;
+            return createTexture(expanded, pixels.data());
+        }
+
+        unsigned int id;
+        glGenTextures(1, &id);
+        GLState::getInstance().bindTexture(0, id);
+
+        GLenum internalFormat = TextureCompressor::glInternalFormat(image.format);
+        int width = image.width, height = image.height;
+        for (size_t level = 0; level < image.levels.size(); ++level) {
+            const std::vector<unsigned char>& data = image.levels[level];
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, width, height, 0,
+                static_cast<GLsizei>(data.size()), data.data());
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size()) - 1);
+        setSampling(desc, image.levels.size() > 1);
+        return id;
+    }
+
+    bool supportsCompressedFormat(CompressedFormat format) const override {
+        if (compressedFormats.empty()) {
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+            compressedFormats.assign(count + 1, 0);   // never empty again, even with no formats
+            if (count > 0) glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, compressedFormats.data());
+        }
+        GLint wanted = static_cast<GLint>(TextureCompressor::glInternalFormat(format));
+        return std::find(compressedFormats.begin(), compressedFormats.end(), wanted) != compressedFormats.end();
+    }
+
+    void deleteTexture(unsigned int id) override { glDeleteTextures(1, &id); }
+
+    unsigned int createBuffer() override {
+        unsigned int id;
+        glGenBuffers(1, &id);
+        return id;
+    }
+
+    void bufferData(GLenum target, size_t bytes, const void* data, GLenum usage) override {
+        glBufferData(target, bytes, data, usage);
+    }
+
+    void deleteBuffer(unsigned int id) override { glDeleteBuffers(1, &id); }
+
+    unsigned int createVertexArray() override {
+        unsigned int id;
+        glGenVertexArrays(1, &id);
+        return id;
+    }
+
+    void deleteVertexArray(unsigned int id) override { glDeleteVertexArrays(1, &id); }
+
+    void vertexAttribute(GLuint location, int components, size_t stride, size_t offset, GLuint divisor) override {
+        glVertexAttribPointer(location, components, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)offset);
+        glEnableVertexAttribArray(location);
+        if (divisor) glVertexAttribDivisor(location, divisor);
+    }
+
+    unsigned int createProgram(const std::string& vertexSource, const std::string& fragmentSource,
+        std::vector<UniformDesc>& uniforms) override {
+        ProgramJob job;
+        job.vertexSource = vertexSource;
+        job.fragmentSource = fragmentSource;
+        beginProgram(job);
+        return finishProgram(job, uniforms);
+    }
+
+    // No status is queried here: that would wait for the compile
+    void beginProgram(ProgramJob& job) override {
+        const ProgramFeatures& features = getProgramFeatures();
+        job.vertexStage = startStage(GL_VERTEX_SHADER, job.vertexSource);
+        job.fragmentStage = startStage(GL_FRAGMENT_SHADER, job.fragmentSource);
+
+        job.program = glCreateProgram();
+        if (features.programParameteri) {
+            features.programParameteri(job.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glAttachShader(job.program, job.vertexStage);
+        glAttachShader(job.program, job.fragmentStage);
+        glLinkProgram(job.program);
+    }
+
+    unsigned int finishProgram(ProgramJob& job, std::vector<UniformDesc>& uniforms) override {
+        uniforms.clear();
+        if (!job.program) return 0;
+
+        bool compiled = checkStage(job.vertexStage, "VERTEX");
+        compiled = checkStage(job.fragmentStage, "FRAGMENT") && compiled;
+
+        GLint success = 0;
+        glGetProgramiv(job.program, GL_LINK_STATUS, &success);
+        if (compiled && !success) {
+            GLchar infoLog[512];
+            glGetProgramInfoLog(job.program, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKETION_FAILED\n" << infoLog << std::endl;
+        }
+
+        glDeleteShader(job.vertexStage);
+        glDeleteShader(job.fragmentStage);
+        job.vertexStage = job.fragmentStage = 0;
+
+        if (!success) {
+            glDeleteProgram(job.program);
+            job.program = 0;
+            return 0;
+        }
+        reflectUniforms(job.program, uniforms);
+        return job.program;
+    }
+
+    std::string getDriverString() override {
+        if (!getProgramFeatures().getProgramBinary) return std::string();
+        auto text = [](GLenum name) {
+            const GLubyte* value = glGetString(name);
+            return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+        };
+        return text(GL_VENDOR) + " | " + text(GL_RENDERER) + " | " + text(GL_VERSION);
+    }
+
+    bool getProgramBinary(unsigned int program, uint32_t& format, std::vector<unsigned char>& binary) override {
+        const ProgramFeatures& features = getProgramFeatures();
+        if (!features.getProgramBinary) return false;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return false;
+
+        binary.resize(static_cast<size_t>(length));
+        GLsizei written = 0;
+        GLenum binaryFormat = 0;
+        features.getProgramBinary(program, length, &written, &binaryFormat, binary.data());
+        binary.resize(static_cast<size_t>(written));
+        format = binaryFormat;
+        return written > 0;
+    }
+
+    unsigned int createProgramFromBinary(uint32_t format, const std::vector<unsigned char>& binary,
+        std::vector<UniformDesc>& uniforms) override {
+        uniforms.clear();
+        const ProgramFeatures& features = getProgramFeatures();
+        if (!features.programBinary || binary.empty()) return 0;
+
+        GLuint program = glCreateProgram();
+        features.programBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glDeleteProgram(program);
+            return 0;
+        }
+        reflectUniforms(program, uniforms);
+        return program;
+    }
+
+    void deleteProgram(unsigned int id) override { glDeleteProgram(id); }
+
+    unsigned int createTimer() override {
+        GLuint id = 0;
+        glGenQueries(1, &id);
+        return id;
+    }
+
+    void deleteTimer(unsigned int id) override { glDeleteQueries(1, &id); }
+    void beginTimer(unsigned int id) override { glBeginQuery(GL_TIME_ELAPSED, id); }
+    void endTimer() override { glEndQuery(GL_TIME_ELAPSED); }
+
+    // A query that was never begun is not available either
+    bool timerResult(unsigned int id, uint64_t& nanoseconds) override {
+        GLint available = 0;
+        glGetQueryObjectiv(id, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(id, GL_QUERY_RESULT, &elapsed);
+        nanoseconds = elapsed;
+        return true;
+    }
+
+    size_t streamUpload(const void* data, size_t bytes, size_t alignment) override {
+        return getStream().upload(data, bytes, alignment);
+    }
+
+    unsigned int streamBuffer() override { return getStream().id(); }
+
+    void useProgram(unsigned int id) override { glUseProgram(id); }
+    void bindVertexArray(unsigned int id) override { glBindVertexArray(id); }
+    void bindBuffer(GLenum target, unsigned int id) override { glBindBuffer(target, id); }
+    void activeTexture(unsigned int unit) override { glActiveTexture(GL_TEXTURE0 + unit); }
+    void bindTexture(unsigned int id) override { glBindTexture(GL_TEXTURE_2D, id); }
+
+    void setBlend(bool enabled) override {
+        if (enabled) glEnable(GL_BLEND);
+        else glDisable(GL_BLEND);
+    }
+
+    void blendFunc(GLenum src, GLenum dst) override { glBlendFunc(src, dst); }
+
+    void setUniform(GLint location, int value) override { glUniform1i(location, value); }
+    void setUniform(GLint location, float value) override { glUniform1f(location, value); }
+    void setUniform(GLint location, float x, float y) override { glUniform2f(location, x, y); }
+    void setUniform(GLint location, float x, float y, float z) override { glUniform3f(location, x, y, z); }
+    void setUniform(GLint location, float x, float y, float z, float w) override { glUniform4f(location, x, y, z, w); }
+
+    void setViewport(int x, int y, int width, int height) override { glViewport(x, y, width, height); }
+
+    void clear(float r, float g, float b) override {
+        glClearColor(r, g, b, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    void drawIndexed(GLenum mode, int indexCount, int baseVertex) override {
+        glDrawElementsBaseVertex(mode, indexCount, GL_UNSIGNED_INT, 0, baseVertex);
+    }
+
+    void drawIndexedInstanced(GLenum mode, int indexCount, int instanceCount) override {
+        glDrawElementsInstanced(mode, indexCount, GL_UNSIGNED_INT, 0, instanceCount);
+    }
+
+    void drawArrays(GLenum mode, int first, int count) override { glDrawArrays(mode, first, count); }
+
+    void endFrame() override {
+        if (stream) stream->endFrame();
+    }
+
+    void printStats() const override {
+        if (stream) stream->printStats();
+    }
+};
+
+#endif // GL_BACKEND_H
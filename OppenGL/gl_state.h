@@ -0,0 +1,200 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+#include "render_backend.h"
+
+// Thin shadow of the GL binding state. Every bind in the game goes through here,
+// so a call that would not change anything is skipped instead of reaching the backend.
+// Code that binds objects behind the backend's back must call invalidate() afterwards.
+class GLState {
+public:
+    struct Stats {
+        int issued = 0;   // calls forwarded to the backend
+        int elided = 0;   // calls skipped because the state was already current
+        int programBinds = 0;       // issued, by kind
+        int vertexArrayBinds = 0;
+        int textureBinds = 0;
+    };
+
+private:
+    static const int maxTextureUnits = 16;
+    static const GLuint unknown = ~0u;
+
+    GLuint program;
+    GLuint vertexArray;
+    GLuint arrayBuffer;
+    GLuint elementBuffer;
+    GLuint pixelUnpackBuffer;
+    GLenum activeUnit;
+    GLuint textures[maxTextureUnits];
+    int blendEnabled;        // -1 unknown, 0 off, 1 on
+    GLenum blendSrc, blendDst;
+
+    Stats frameStats;
+    Stats lastFrameStats;
+
+    GLState() { invalidate(); }
+
+    bool change(GLuint& current, GLuint value) {
+        if (current == value) {
+            ++frameStats.elided;
+            return false;
+        }
+        current = value;
+        ++frameStats.issued;
+        return true;
+    }
+
+    static RenderBackend& backend() { return RenderBackend::get(); }
+
+public:
+    static GLState& getInstance() {
+        static GLState instance;
+        return instance;
+    }
+
+    GLState(const GLState&) = delete;
+    GLState& operator=(const GLState&) = delete;
+
+    // Forgets everything, the next bind of each kind is always issued
+    void invalidate() {
+        program = unknown;
+        vertexArray = unknown;
+        arrayBuffer = unknown;
+        elementBuffer = unknown;
+        pixelUnpackBuffer = unknown;
+        activeUnit = unknown;
+        for (int i = 0; i < maxTextureUnits; ++i) textures[i] = unknown;
+        blendEnabled = -1;
+        blendSrc = blendDst = unknown;
+    }
+
+    void useProgram(GLuint id) {
+        if (change(program, id)) {
+            ++frameStats.programBinds;
+            backend().useProgram(id);
+        }
+    }
+
+    void bindVertexArray(GLuint id) {
+        if (change(vertexArray, id)) {
+            ++frameStats.vertexArrayBinds;
+            backend().bindVertexArray(id);
+            // The element buffer binding is part of the VAO
+            elementBuffer = unknown;
+        }
+    }
+
+    void bindBuffer(GLenum target, GLuint id) {
+        GLuint* current = nullptr;
+        switch (target) {
+        case GL_ARRAY_BUFFER: current = &arrayBuffer; break;
+        case GL_ELEMENT_ARRAY_BUFFER: current = &elementBuffer; break;
+        case GL_PIXEL_UNPACK_BUFFER: current = &pixelUnpackBuffer; break;
+        }
+        if (!current) {
+            ++frameStats.issued;
+            backend().bindBuffer(target, id);
+            return;
+        }
+        if (change(*current, id)) backend().bindBuffer(target, id);
+    }
+
+    void activeTexture(unsigned int unit) {
+        if (change(activeUnit, unit)) backend().activeTexture(unit);
+    }
+
+    // Binds a 2D texture to the given unit, switching the active unit only if needed
+    void bindTexture(unsigned int unit, GLuint id) {
+        if (unit >= static_cast<unsigned int>(maxTextureUnits)) {
+            activeTexture(unit);
+            ++frameStats.issued;
+            ++frameStats.textureBinds;
+            backend().bindTexture(id);
+            return;
+        }
+        if (textures[unit] == id) {
+            ++frameStats.elided;
+            return;
+        }
+        activeTexture(unit);
+        textures[unit] = id;
+        ++frameStats.issued;
+        ++frameStats.textureBinds;
+        backend().bindTexture(id);
+    }
+
+    void setBlend(bool enabled) {
+        int value = enabled ? 1 : 0;
+        if (blendEnabled == value) {
+            ++frameStats.elided;
+            return;
+        }
+        blendEnabled = value;
+        ++frameStats.issued;
+        backend().setBlend(enabled);
+    }
+
+    void blendFunc(GLenum src, GLenum dst) {
+        if (blendSrc == src && blendDst == dst) {
+            ++frameStats.elided;
+            return;
+        }
+        blendSrc = src;
+        blendDst = dst;
+        ++frameStats.issued;
+        backend().blendFunc(src, dst);
+    }
+
+    // Deleting a bound object resets that binding to 0 in GL, mirror it here
+    void deleteProgram(GLuint id) {
+        if (program == id) program = 0;
+        backend().deleteProgram(id);
+    }
+
+    void deleteVertexArray(GLuint id) {
+        if (vertexArray == id) {
+            vertexArray = 0;
+            elementBuffer = unknown;
+        }
+        backend().deleteVertexArray(id);
+    }
+
+    void deleteBuffer(GLuint id) {
+        if (arrayBuffer == id) arrayBuffer = 0;
+        if (elementBuffer == id) elementBuffer = 0;
+        if (pixelUnpackBuffer == id) pixelUnpackBuffer = 0;
+        backend().deleteBuffer(id);
+    }
+
+    void deleteTexture(GLuint id) {
+        for (int i = 0; i < maxTextureUnits; ++i) {
+            if (textures[i] == id) textures[i] = 0;
+        }
+        backend().deleteTexture(id);
+    }
+
+    // Called once per frame after the swap
+    void endFrame() {
+        lastFrameStats = frameStats;
+        frameStats = Stats();
+    }
+
+    const Stats& getLastFrameStats() const { return lastFrameStats; }
+
+    void printStats() const {
+        int total = lastFrameStats.issued + lastFrameStats.elided;
+        std::cout << "GL state: " << lastFrameStats.issued << " calls issued, "
+            << lastFrameStats.elided << " elided";
+        if (total > 0) {
+            std::cout << " (" << (100 * lastFrameStats.elided / total) << "% saved)";
+        }
+        std::cout << std::endl;
+    }
+};
+
+#endif // GL_STATE_H
@@ -0,0 +1,86 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+// What the game reads from the keyboard, the mouse and the window.
+// Backed by a GLFW window, or scripted when the game runs headless: then nothing
+// touches GLFW and tests drive keys and the cursor through the setters.
+class Input {
+private:
+    GLFWwindow* window;
+    std::vector<bool> keys;
+    double cursorX, cursorY;
+    int width, height;
+    float viewX, viewY, viewHalfWidth, viewHalfHeight;   // world rectangle the window shows
+
+public:
+    explicit Input(GLFWwindow* window)
+        : window(window), keys(GLFW_KEY_LAST + 1, false), cursorX(0.0), cursorY(0.0), width(0), height(0),
+        viewX(0.0f), viewY(0.0f), viewHalfWidth(1.0f), viewHalfHeight(1.0f) {}
+
+    Input(int width, int height)
+        : window(nullptr), keys(GLFW_KEY_LAST + 1, false),
+        cursorX(width / 2.0), cursorY(height / 2.0), width(width), height(height),
+        viewX(0.0f), viewY(0.0f), viewHalfWidth(1.0f), viewHalfHeight(1.0f) {}
+
+    GLFWwindow* getWindow() const { return window; }
+    bool isHeadless() const { return window == nullptr; }
+
+    bool isKeyDown(int key) const {
+        if (window) return glfwGetKey(window, key) == GLFW_PRESS;
+        return key >= 0 && key < static_cast<int>(keys.size()) && keys[key];
+    }
+
+    void getCursorPos(double* x, double* y) const {
+        if (window) {
+            glfwGetCursorPos(window, x, y);
+            return;
+        }
+        *x = cursorX;
+        *y = cursorY;
+    }
+
+    void getWindowSize(int* w, int* h) const {
+        if (window) {
+            glfwGetWindowSize(window, w, h);
+            return;
+        }
+        *w = width;
+        *h = height;
+    }
+
+    // The camera view, so the cursor can be mapped into the world
+    void setView(float centreX, float centreY, float halfWidth, float halfHeight) {
+        viewX = centreX;
+        viewY = centreY;
+        viewHalfWidth = halfWidth;
+        viewHalfHeight = halfHeight;
+    }
+
+    // Cursor in world coordinates, through the current view
+    void getCursorWorld(float* x, float* y) const {
+        double xpos, ypos;
+        getCursorPos(&xpos, &ypos);
+        int w, h;
+        getWindowSize(&w, &h);
+        float ndcX = (2.0f * xpos) / w - 1.0f;
+        float ndcY = 1.0f - (2.0f * ypos) / h;
+        *x = viewX + ndcX * viewHalfWidth;
+        *y = viewY + ndcY * viewHalfHeight;
+    }
+
+    // Scripted input, ignored while a window is attached
+    void setKey(int key, bool down) {
+        if (key >= 0 && key < static_cast<int>(keys.size())) keys[key] = down;
+    }
+
+    void setCursorPos(double x, double y) {
+        cursorX = x;
+        cursorY = y;
+    }
+};
+
+#endif // INPUT_H
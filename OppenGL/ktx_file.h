@@ -0,0 +1,139 @@
+#ifndef KTX_FILE_H
+#define KTX_FILE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+#include "render_backend.h"
+#include "texture_compress.h"
+
+// Reads and writes KTX 1.1 files holding one block-compressed 2D texture with its mip chain.
+// Only what the game uses is supported: a single face, no array layers, compressed
+// formats known to TextureCompressor, little-endian files.
+class KTXFile {
+private:
+    struct Header {
+        uint32_t endianness;
+        uint32_t glType;
+        uint32_t glTypeSize;
+        uint32_t glFormat;
+        uint32_t glInternalFormat;
+        uint32_t glBaseInternalFormat;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t numberOfArrayElements;
+        uint32_t numberOfFaces;
+        uint32_t numberOfMipmapLevels;
+        uint32_t bytesOfKeyValueData;
+    };
+
+    static const uint32_t nativeEndianness = 0x04030201;
+
+    static const unsigned char* identifier() {
+        static const unsigned char id[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+        return id;
+    }
+
+public:
+    static bool exists(const std::string& path) {
+        return AssetPack::getInstance().exists(path);
+    }
+
+    // false without a message if the file does not exist, with one if it is not usable
+    static bool load(const std::string& path, CompressedImage& image) {
+        AssetData file;
+        if (!AssetPack::getInstance().load(path, file)) return false;
+        return parse(file.data(), file.size(), path, image);
+    }
+
+    // A whole KTX file in memory; path only names it in messages
+    static bool parse(const unsigned char* data, size_t size, const std::string& path, CompressedImage& image) {
+        Header header;
+        if (size < sizeof(header) + 12 || std::memcmp(data, identifier(), 12) != 0) {
+            std::cerr << "KTX: '" << path << "' is not a KTX 1.1 file" << std::endl;
+            return false;
+        }
+        std::memcpy(&header, data + 12, sizeof(header));
+        if (header.endianness != nativeEndianness || header.glType != 0 || header.numberOfFaces != 1 ||
+            header.numberOfArrayElements > 1 || header.pixelDepth > 1 ||
+            !TextureCompressor::fromGLInternalFormat(header.glInternalFormat, image.format)) {
+            std::cerr << "KTX: '" << path << "' is not a supported compressed 2D texture" << std::endl;
+            return false;
+        }
+
+        image.width = static_cast<int>(header.pixelWidth);
+        image.height = static_cast<int>(header.pixelHeight);
+        size_t offset = 12 + sizeof(header);
+        if (header.bytesOfKeyValueData > size - offset) {
+            std::cerr << "KTX: '" << path << "' is truncated" << std::endl;
+            return false;
+        }
+        offset += header.bytesOfKeyValueData;
+
+        uint32_t levelCount = header.numberOfMipmapLevels ? header.numberOfMipmapLevels : 1;
+        image.levels.assign(levelCount, std::vector<unsigned char>());
+        int width = image.width, height = image.height;
+        for (uint32_t level = 0; level < levelCount; ++level) {
+            uint32_t imageSize = 0;
+            if (size - offset < sizeof(imageSize)) {
+                std::cerr << "KTX: '" << path << "' is truncated" << std::endl;
+                return false;
+            }
+            std::memcpy(&imageSize, data + offset, sizeof(imageSize));
+            offset += sizeof(imageSize);
+            if (imageSize != TextureCompressor::levelBytes(image.format, width, height)) {
+                std::cerr << "KTX: '" << path << "' has a broken mip level " << level << std::endl;
+                return false;
+            }
+            if (imageSize > size - offset) {
+                std::cerr << "KTX: '" << path << "' is truncated" << std::endl;
+                return false;
+            }
+            image.levels[level].assign(data + offset, data + offset + imageSize);
+            offset += imageSize + (4 - imageSize % 4) % 4;   // mipPadding
+            if (offset > size) offset = size;
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+        return true;
+    }
+
+    static bool save(const std::string& path, const CompressedImage& image) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "KTX: cannot write '" << path << "'" << std::endl;
+            return false;
+        }
+
+        Header header = {};
+        header.endianness = nativeEndianness;
+        header.glTypeSize = 1;
+        header.glInternalFormat = TextureCompressor::glInternalFormat(image.format);
+        header.glBaseInternalFormat = TextureCompressor::hasAlpha(image.format) ? GL_RGBA : GL_RGB;
+        header.pixelWidth = static_cast<uint32_t>(image.width);
+        header.pixelHeight = static_cast<uint32_t>(image.height);
+        header.numberOfFaces = 1;
+        header.numberOfMipmapLevels = static_cast<uint32_t>(image.levels.size());
+
+        file.write(reinterpret_cast<const char*>(identifier()), 12);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        const char padding[4] = {};
+        for (const std::vector<unsigned char>& level : image.levels) {
+            uint32_t imageSize = static_cast<uint32_t>(level.size());
+            file.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+            file.write(reinterpret_cast<const char*>(level.data()), imageSize);
+            file.write(padding, (4 - imageSize % 4) % 4);
+        }
+        return static_cast<bool>(file);
+    }
+};
+
+#endif // KTX_FILE_H
@@ -0,0 +1,152 @@
+#ifndef LEVEL_GEOMETRY_H
+#define LEVEL_GEOMETRY_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "quad_mesh.h"
+#include "sprite_batch.h"
+#include "render_queue.h"
+#include "render_backend.h"
+#include "render_stats.h"
+#include "texture_atlas.h"
+#include "collide.h"
+
+// Static scenery of a level (ground, platforms, tiles) baked once into static instance buffers.
+// Quads are grouped into square chunks by their centre and by atlas page; every chunk is one
+// VBO and one instanced draw, so the per-frame cost depends on the number of chunks on
+// screen, not on the number of tiles. Uses the sprite program and its instance layout.
+//
+// add() everything at level load, then bake() on the render thread (inside Level::init).
+class LevelGeometry : public Drawable {
+private:
+    struct Quad {
+        float x, y, width, height;
+        Vec4 texCoords;
+        uint32_t shape;
+    };
+
+    struct Chunk {
+        TextureHandle texture;
+        std::vector<Quad> quads;     // until bake()
+        unsigned int VAO = 0, VBO = 0;
+        int instanceCount = 0;
+        float minX = 0.0f, minY = 0.0f, maxX = 0.0f, maxY = 0.0f;
+    };
+
+    float chunkSize;
+    std::vector<Chunk> chunks;
+    std::map<std::pair<std::pair<int, int>, unsigned int>, size_t> chunkIndex;   // (cell, texture) -> chunk
+    bool baked;
+
+public:
+    explicit LevelGeometry(float chunkSize = 1.0f)
+        : chunkSize(chunkSize), baked(false) {}
+
+    LevelGeometry(const LevelGeometry&) = delete;
+    LevelGeometry& operator=(const LevelGeometry&) = delete;
+
+    // texCoords as in Sprite: x/z the u of the left/right edge, y/w the v of the top/bottom edge.
+    // shape is the frame's outline when texCoords covers the whole frame, 0 otherwise.
+    void addQuad(const AtlasFrame& frame, float x, float y, float width, float height, const Vec4& texCoords,
+        uint32_t shape = 0) {
+        if (baked) {
+            std::cerr << "LevelGeometry: quads added after bake() are ignored" << std::endl;
+            return;
+        }
+        int cellX = static_cast<int>(std::floor(x / chunkSize));
+        int cellY = static_cast<int>(std::floor(y / chunkSize));
+        auto key = std::make_pair(std::make_pair(cellX, cellY), frame.texture.id());
+
+        auto it = chunkIndex.find(key);
+        if (it == chunkIndex.end()) {
+            it = chunkIndex.emplace(key, chunks.size()).first;
+            chunks.emplace_back();
+            chunks.back().texture = frame.texture;
+        }
+        chunks[it->second].quads.push_back({ x, y, width, height, texCoords, shape });
+    }
+
+    // A collider is drawn with its whole frame stretched over it, flipped vertically
+    void add(Collide& collide) {
+        const AtlasFrame& frame = collide.getFrame();
+        const Vec4& uv = frame.texCoords;
+        addQuad(frame, collide.getX(), collide.getY(), collide.getWidth(), collide.getHeight(),
+            Vec4(uv.x, uv.w, uv.z, uv.y), frame.shape);
+    }
+
+    // Uploads every chunk into its own static buffer; needs the render thread
+    void bake() {
+        RenderBackend& backend = RenderBackend::get();
+        GLState& gl = GLState::getInstance();
+        std::vector<SpriteInstance> instances;
+
+        for (Chunk& chunk : chunks) {
+            instances.clear();
+            chunk.minX = chunk.minY = 1e30f;
+            chunk.maxX = chunk.maxY = -1e30f;
+            for (const Quad& quad : chunk.quads) {
+                float left = quad.x - quad.width / 2, right = quad.x + quad.width / 2;
+                float bottom = quad.y - quad.height / 2, top = quad.y + quad.height / 2;
+                instances.emplace_back(Sprite(quad.x, quad.y, quad.width, quad.height, quad.texCoords, 0.0f, 1.0f, quad.shape));
+
+                chunk.minX = std::min(chunk.minX, left);
+                chunk.maxX = std::max(chunk.maxX, right);
+                chunk.minY = std::min(chunk.minY, bottom);
+                chunk.maxY = std::max(chunk.maxY, top);
+            }
+
+            chunk.VAO = backend.createVertexArray();
+            chunk.VBO = backend.createBuffer();
+            gl.bindVertexArray(chunk.VAO);
+            QuadMesh::getInstance().attachOutline(SpriteProgram::aCorner);
+
+            gl.bindBuffer(GL_ARRAY_BUFFER, chunk.VBO);
+            backend.bufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(SpriteInstance), instances.data(), GL_STATIC_DRAW);
+            SpriteRenderer::attachInstances(0);
+
+            chunk.instanceCount = static_cast<int>(instances.size());
+            chunk.quads.clear();
+            chunk.quads.shrink_to_fit();
+        }
+        chunkIndex.clear();
+        baked = true;
+    }
+
+    // Chunks outside the camera view are skipped
+    void draw(RenderQueue& queue) {
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            const Chunk& chunk = chunks[i];
+            if (!queue.isVisible(chunk.minX, chunk.minY, chunk.maxX, chunk.maxY)) continue;
+            float* data = queue.push(RenderLayer::Background, this, RenderQueue::spriteProgram, chunks[i].texture.id(), 1, 1);
+            data[0] = static_cast<float>(i);
+        }
+    }
+
+    void render(const float* data, uint32_t) override {
+        const Chunk& chunk = chunks[static_cast<size_t>(data[0])];
+
+        SpriteRenderer::getInstance().bind(chunk.texture.id());
+        GLState::getInstance().bindVertexArray(chunk.VAO);
+
+        RenderBackend::get().drawIndexedInstanced(GL_TRIANGLES, QuadMesh::outlineIndexCount, chunk.instanceCount);
+        RenderStats::getInstance().recordDraw(GL_TRIANGLES, QuadMesh::outlineIndexCount, chunk.instanceCount);
+    }
+
+    size_t getChunkCount() const { return chunks.size(); }
+
+    ~LevelGeometry() {
+        GLState& gl = GLState::getInstance();
+        for (Chunk& chunk : chunks) {
+            if (chunk.VAO) gl.deleteVertexArray(chunk.VAO);
+            if (chunk.VBO) gl.deleteBuffer(chunk.VBO);
+        }
+    }
+};
+
+#endif // LEVEL_GEOMETRY_H
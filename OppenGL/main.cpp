@@ -2,6 +2,9 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <random>
+#include <chrono>
+#include <cstring>
+#include <string>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -15,12 +18,20 @@
 #include "arm.h"
 #include "crosshair.h"
 #include "GameState.h"
+#include "render_backend.h"
+#include "gl_backend.h"
+#include "software_backend.h"
+#include "asset_cook.h"
+#include "shader_embed.h"
 
 float lastFrame = 0.0f; //   
 
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
+    // Events arrive on the main thread, the context lives on the render thread
+    GameManager::getInstance()->getRenderThread().post([width, height] {
+        RenderBackend::get().setViewport(0, 0, width, height);
+    });
 }
 
 GLfloat mixValue = 0.2f;
@@ -29,10 +40,182 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GL_TRUE);
     }
+    if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
+        GameManager::getInstance()->getRenderThread().post([] {
+            GLState::getInstance().printStats();
+            RenderStats::getInstance().printStats();
+            RenderBackend::get().printStats();
+        });
+    }
+    if (key == GLFW_KEY_F2 && action == GLFW_PRESS) {
+        GameManager::getInstance()->getRenderThread().post([] {
+            StatsOverlay::getInstance().toggle();
+        });
+    }
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+        GameManager::getInstance()->getRenderThread().post([] {
+            SpriteRenderer& sprites = SpriteRenderer::getInstance();
+            sprites.setOverdraw(!sprites.isOverdraw());
+        });
+    }
+}
+
+
+struct HeadlessOptions {
+    std::string backend;      // null, record or software
+    int frames = 600;
+    int level = 1;
+    std::string capture;      // software only: PPM of the last frame
+    int captureScale = 1;     // box filter factor for thumbnails
+    bool statsOverlay = false;
+    std::string overdraw;     // software only: heatmap of the last frame's fragments per pixel
+};
+
+// Plays a level without a window: D held down and a shot every 15 frames, at a fixed 60 Hz step.
+// "null" measures the CPU side alone, "record" also counts what would have reached the GPU,
+// "software" rasterizes every frame on the CPU and prints a checksum of the last one.
+int runHeadless(const HeadlessOptions& options) {
+    RecordingBackend* recorder = nullptr;
+    SoftwareBackend* software = nullptr;
+    if (options.backend == "record") {
+        recorder = new RecordingBackend();
+        RenderBackend::set(std::unique_ptr<RenderBackend>(recorder));
+    }
+    else if (options.backend == "software") {
+        software = new SoftwareBackend(1920, 1080);
+        if (!options.overdraw.empty()) software->setOverdrawCounting(true);
+        RenderBackend::set(std::unique_ptr<RenderBackend>(software));
+    }
+    else if (options.backend == "null") {
+        RenderBackend::set(std::unique_ptr<RenderBackend>(new NullBackend()));
+    }
+    else {
+        std::cerr << "Unknown headless backend '" << options.backend << "', use null, record or software" << std::endl;
+        return -1;
+    }
+
+    // The same run has to produce the same frames
+    ParticleEmitter::fixedSeed() = 1;
+
+    GameManager* gameManager = GameManager::getInstance();
+    gameManager->initHeadless(1920, 1080);
+    if (options.statsOverlay) {
+        gameManager->getRenderThread().invoke([] { StatsOverlay::getInstance().setEnabled(true); });
+    }
+    Input& input = gameManager->getInput();
+    if (options.level == 2) {
+        gameManager->changeLevel(std::make_unique<Level2>(input));
+    }
+    else {
+        gameManager->changeLevel(std::make_unique<Level1>(input));
+    }
+
+    int frames = options.frames;
+    auto start = std::chrono::steady_clock::now();
+    gameManager->runFrames(frames, 1.0f / 60.0f, [&input](int frame) {
+        input.setKey(GLFW_KEY_D, true);
+        if (frame % 15 == 0) {
+            GameLevel::dispatchMouseClick(GLFW_MOUSE_BUTTON_LEFT, GLFW_PRESS, 0);
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    gameManager->shutdown();
+
+    std::cout << "Headless (" << RenderBackend::get().getName() << "): " << frames << " frames, "
+        << (frames > 0 ? 1000.0 * seconds / frames : 0.0) << " ms/frame" << std::endl;
+    std::cout << "Assets: " << AssetPack::getInstance().getPackReads() << " read from the pack, "
+        << AssetPack::getInstance().getDiskReads() << " from loose files" << std::endl;
+    const RenderStats& stats = RenderStats::getInstance();
+    if (stats.getFrameCount() > 0) {
+        const RenderStats::Counters& total = stats.getTotalCounters();
+        int rendered = stats.getFrameCount();
+        std::cout << "Render stats per frame: " << total.drawCalls / rendered << " draws, "
+            << total.triangles / rendered << " triangles, "
+            << total.programBinds / rendered << " program / " << total.textureBinds / rendered << " texture / "
+            << total.vertexArrayBinds / rendered << " VAO binds, "
+            << total.bytesUploaded / rendered / 1024 << " KB uploaded" << std::endl;
+        stats.printPassTimes();
+    }
+    if (recorder && recorder->getFrameCount() > 0) {
+        const RecordingBackend::Counters& total = recorder->getTotalCounters();
+        int recorded = recorder->getFrameCount();
+        std::cout << "Per frame: " << total.drawCalls / recorded << " draw calls, "
+            << total.stateChanges / recorded << " state changes, "
+            << total.uniformSets / recorded << " uniform sets, "
+            << total.bytesStreamed / recorded / 1024 << " KB streamed" << std::endl;
+    }
+    if (software) {
+        const SoftwareBackend::Stats& total = software->getTotalStats();
+        double pixels = static_cast<double>(total.fragments + total.clearedPixels);
+        std::cout << "Rasterizer: " << total.fragments << " fragments, " << total.triangles << " triangles, "
+            << (total.rasterSeconds > 0.0 ? pixels / total.rasterSeconds / 1e6 : 0.0) << " Mpix/s" << std::endl;
+        std::cout << "Last frame checksum: " << std::hex << software->getLastFrameChecksum() << std::dec << std::endl;
+        if (!options.capture.empty() && software->writePPM(options.capture, options.captureScale)) {
+            std::cout << "Captured " << options.capture << std::endl;
+        }
+        if (!options.overdraw.empty()) {
+            SoftwareBackend::Overdraw overdraw = software->getLastFrameOverdraw();
+            std::cout << "Overdraw: " << overdraw.fragments << " fragments on " << overdraw.coveredPixels << " pixels, "
+                << (overdraw.coveredPixels > 0 ? static_cast<double>(overdraw.fragments) / overdraw.coveredPixels : 0.0)
+                << " per covered pixel, at most " << overdraw.maxLayers << std::endl;
+            if (software->writeOverdrawPPM(options.overdraw, options.captureScale)) {
+                std::cout << "Captured " << options.overdraw << std::endl;
+            }
+        }
+    }
+    return 0;
+}
+
+
+// Cooks the atlas into "cooked" (BC1/BC3, or ETC2 for GLES-class GPUs), then packs it together
+// with the images into cooked/assets.pak; unchanged inputs are skipped. Shaders are embedded.
+// Needs no window or GL context, and reads only loose files.
+int runCook(bool etc) {
+    AssetCooker cooker("cooked", etc);
+    TextureAtlas& atlas = TextureAtlas::getInstance();
+    GameManager::registerAtlasSheets(atlas);
+    bool ok = cooker.cookAtlas(atlas);
+
+    std::vector<std::string> files;
+    for (const std::string& path : atlas.getSheetPaths()) {
+        files.push_back(path);
+        if (TextureCache::hasCompressed(path)) files.push_back(TextureCache::compressedPath(path));
+    }
+    for (const std::string& path : TextureAtlas::getCookedFiles("cooked")) {
+        files.push_back(path);
+    }
+    ok = ok && cooker.cookPack("assets.pak", files);
+    std::cout << "Cook: " << cooker.getCookedCount() << " cooked, " << cooker.getUpToDateCount() << " up to date" << std::endl;
+    return ok ? 0 : -1;
+}
+
+
+// Regenerates shader_sources.h from the .glsl files; run from the source directory after editing one
+int runEmbedShaders() {
+    return ShaderEmbedder::write(GameManager::shaderPrograms(), "shader_sources.h") ? 0 : -1;
 }
 
 
-int main() {
+int main(int argc, char* argv[]) {
+    HeadlessOptions headless;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--cook") == 0) return runCook(false);
+        if (std::strcmp(argv[i], "--cook=etc2") == 0) return runCook(true);
+        if (std::strcmp(argv[i], "--embed-shaders") == 0) return runEmbedShaders();
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--headless=", 11) == 0) headless.backend = argv[i] + 11;
+        else if (std::strncmp(argv[i], "--frames=", 9) == 0) headless.frames = std::atoi(argv[i] + 9);
+        else if (std::strncmp(argv[i], "--level=", 8) == 0) headless.level = std::atoi(argv[i] + 8);
+        else if (std::strncmp(argv[i], "--capture=", 10) == 0) headless.capture = argv[i] + 10;
+        else if (std::strncmp(argv[i], "--capture-scale=", 16) == 0) headless.captureScale = std::atoi(argv[i] + 16);
+        else if (std::strcmp(argv[i], "--stats-overlay") == 0) headless.statsOverlay = true;
+        else if (std::strncmp(argv[i], "--overdraw=", 11) == 0) headless.overdraw = argv[i] + 11;
+    }
+    if (!headless.backend.empty()) {
+        return runHeadless(headless);
+    }
+
     glfwInit();
 
 
@@ -54,6 +237,7 @@ int main() {
         std::cerr << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    RenderBackend::set(std::unique_ptr<RenderBackend>(new GLBackend()));
 
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetKeyCallback(window, key_callback);
@@ -63,8 +247,9 @@ int main() {
     auto gameManager = GameManager::getInstance();
 
     GameManager::getInstance()->init(window);
-    GameManager::getInstance()->changeLevel(std::make_unique<MainMenu>(window));
+    GameManager::getInstance()->changeLevel(std::make_unique<MainMenu>(GameManager::getInstance()->getInput()));
     GameManager::getInstance()->runGameLoop();
+    GameManager::getInstance()->shutdown();
 
     glfwTerminate();
     return 0;
@@ -9,121 +9,124 @@
 #include <sstream> 
 #include <iostream> 
 #include <random>
+#include <algorithm>
 
-#include "shader.h"
-#include "stb_image.h"
+#include "texture_atlas.h"
+#include "sprite_batch.h"
+#include "render_queue.h"
 #include "collide.h"
 #include "character.h"
 
-#include <GLFW/glfw3.h>
+#include "input.h"
 
-class ParticleEmitter {
+// Emits, simulates and draws every particle of one effect.
+// Particle state lives in parallel arrays (one entry per live particle) so the update,
+// expiry and collision passes are straight loops over contiguous memory; the visible
+// particles become sprite instances drawn with one instanced draw.
+class ParticleEmitter : public Drawable {
 private:
-
-    glm::mat4 projection;
-
     float particleSpeed;
-    float particleDamage;
     float particleLifetime;
+    float spawnRate;           // particles per second
+    float spawnAccumulator;
+    bool emitting;
 
-    unsigned int texture1;
+    AtlasFrame frame;
 
-    float width, height;
-    unsigned int VAO, VBO, EBO;
-
-    float quadLeft, quadRight, quadTop, quadBottom;
+    float width, height;       // hit box of a single particle
 
     float characterWidth = 0.25f;  //     
     float characterHeight = 0.25f; //     
 
-    int hp;
-    bool isAlive;
-    
     float attackCooldown;
     float timeSinceLastAttack;
     int damage;
 
     bool isfallsdown;
 
-    Shader particleShader;
-
-    unsigned int loadTexture(const char* path) {
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-
-        int width, height, nrComponents;
-        unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-        if (data) {
-            GLenum format;
-            if (nrComponents == 1)
-                format = GL_RED;
-            else if (nrComponents == 3)
-                format = GL_RGB;
-            else if (nrComponents == 4)
-                format = GL_RGBA;
-
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            stbi_image_free(data);
+    // Particles leaving this world rectangle die; the level's extents, see setBounds()
+    float boundsMinX = -1.0f, boundsMinY = -1.0f, boundsMaxX = 1.0f, boundsMaxY = 1.0f;
+
+    int maxParticles;
+    int liveCount;
+    std::vector<float> posX, posY;
+    std::vector<float> velX, velY;
+    std::vector<float> age;
+    std::vector<float> size;
+
+    std::vector<int> visible;  // indices of the particles drawn this frame
+
+    std::mt19937 gen;
+
+    void spawn() {
+        if (liveCount >= maxParticles) return;
+
+        int i = liveCount++;
+        if (!isfallsdown) {
+            posX[i] = startX;
+            posY[i] = startY;
+            velX[i] = -particleSpeed;
+            velY[i] = 0.0f;
         }
         else {
-            std::cout << "Texture failed to load at path: " << path << std::endl;
-            stbi_image_free(data);
+            std::uniform_real_distribution<float> dis(-1.0f, 0.7f);
+            posX[i] = dis(gen);
+            posY[i] = startY;
+            velX[i] = 0.0f;
+            velY[i] = -particleSpeed;
         }
+        age[i] = 0.0f;
+        size[i] = characterWidth;
+    }
 
-        return textureID;
+    // Removes particle i by moving the last live particle into its slot
+    void kill(int i) {
+        int last = --liveCount;
+        posX[i] = posX[last];
+        posY[i] = posY[last];
+        velX[i] = velX[last];
+        velY[i] = velY[last];
+        age[i] = age[last];
+        size[i] = size[last];
     }
 
 public:
-    float x, y; 
     float startX, startY;
     Character* character; 
 
+    // Non-zero: every emitter created afterwards uses this seed, so captured frames repeat exactly
+    static unsigned int& fixedSeed() {
+        static unsigned int seed = 0;
+        return seed;
+    }
+
     ParticleEmitter(float startX, float startY, float characterWidth, float characterHeight, float moveSpeed,
-        const char* vertexPath, const char* fragmentPath,
         const char* texturePath,
-        float screenWidth, float screenHeight, bool isfallsdown)
-        : x(startX), y(startY), width(characterWidth), height(characterHeight), particleSpeed(moveSpeed),
-        particleShader(vertexPath, fragmentPath),
-        quadLeft(-width / 2), quadRight(width / 2), quadTop(height / 2), quadBottom(-height / 2),
-        hp(5), isAlive(true), attackCooldown(1.0f), timeSinceLastAttack(0.0f), damage(10), startX(startX), startY(startY), isfallsdown(isfallsdown)
+        float screenWidth, float screenHeight, bool isfallsdown, int maxParticles = 65536)
+        : particleSpeed(moveSpeed), particleLifetime(5.0f), spawnRate(1.0f), spawnAccumulator(1.0f), emitting(true),
+        width(characterWidth), height(characterHeight),
+        attackCooldown(1.0f), timeSinceLastAttack(0.0f), damage(10), isfallsdown(isfallsdown),
+        maxParticles(maxParticles), liveCount(0),
+        posX(maxParticles), posY(maxParticles), velX(maxParticles), velY(maxParticles), age(maxParticles), size(maxParticles),
+        gen(fixedSeed() ? fixedSeed() : std::random_device()()),
+        startX(startX), startY(startY), character(nullptr)
     {
-        setupMesh();
-        texture1 = loadTexture(texturePath);
+        frame = TextureAtlas::getInstance().getFrame(texturePath, TextureFilter::Linear);
     }
 
-    void handleMouseClick(GLFWwindow* window, int button, int action, int mods) {
-        if (!isAlive) return;
-
+    void handleMouseClick(const Input& input, int button, int action, int mods) {
         if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-            double xpos, ypos;
-            glfwGetCursorPos(window, &xpos, &ypos);
-            int width, height;
-            glfwGetWindowSize(window, &width, &height);
-            float clickX = (2.0f * xpos) / width - 1.0f;
-            float clickY = 1.0f - (2.0f * ypos) / height;
-
-            // Adjust click coordinates based on enemy position
-            clickX -= x;
-            clickY -= y;
-
-            if (clickX >= quadLeft && clickX <= quadRight &&
-                clickY >= quadBottom && clickY <= quadTop) {
-                // Hit detected, create a bullet trace
-                float traceX = x + clickX;  // Convert to world coordinates
-                float traceY = y + clickY;
-                hp -= 5;
-                std::cout << "boss hit! HP: " << hp << std::endl;
-                if (hp <= 0) {
-                    isAlive = false;
-                    std::cout << "par defeated!" << std::endl;
+            float clickX, clickY;
+            input.getCursorWorld(&clickX, &clickY);
+
+            for (int i = 0; i < liveCount; ) {
+                if (clickX >= posX[i] - this->width / 2 && clickX <= posX[i] + this->width / 2 &&
+                    clickY >= posY[i] - this->height / 2 && clickY <= posY[i] + this->height / 2) {
+                    kill(i);
+                    std::cout << "Particle destroyed!" << std::endl;
+                }
+                else {
+                    ++i;
                 }
             }
         }
@@ -133,155 +136,101 @@ public:
         character = obj;
     }
 
-    bool getIsAlive() const { return isAlive; }
-
-    bool isCollidingWithPlayer() {
-        float enemyLeft = x - width / 2;
-        float enemyRight = x + width / 2;
-        float enemyTop = y + height / 2;
-        float enemyBottom = y - height / 2;
-
-        float playerLeft = character->getX() - character->getWidth() / 2;
-        float playerRight = character->getX() + character->getWidth() / 2;
-        float playerTop = character->getY() + character->getHeight() / 2;
-        float playerBottom = character->getY() - character->getHeight() / 2;
+    void setSpawnRate(float particlesPerSecond) { spawnRate = particlesPerSecond; }
+    void setLifetime(float seconds) { particleLifetime = seconds; }
+    void setEmitting(bool value) { emitting = value; }
 
-        return (enemyLeft < playerRight &&
-            enemyRight > playerLeft &&
-            enemyTop > playerBottom &&
-            enemyBottom < playerTop);
+    // The world rectangle particles live in, normally the level's extents
+    void setBounds(float minX, float minY, float maxX, float maxY) {
+        boundsMinX = minX;
+        boundsMinY = minY;
+        boundsMaxX = maxX;
+        boundsMaxY = maxY;
     }
 
-    void attackPlayer() {
-        bool isCollidingWithPlayer = this->isCollidingWithPlayer();
-        //std::cout << "Enemy position: (" << x << ", " << y << ")" << std::endl;
-        //std::cout << "Player position: (" << character->getX() << ", " << character->getY() << ")" << std::endl;
-        //std::cout << "Attacking player: cooldown: " << timeSinceLastAttack
-        //    << ", colliding: " << isCollidingWithPlayer
-        //    << ", distance: " << std::sqrt(std::pow(x - character->getX(), 2) + std::pow(y - character->getY(), 2))
-        //    << std::endl;
-
-        if (timeSinceLastAttack >= attackCooldown && isCollidingWithPlayer) {
-            character->takeDamage(damage);
-            timeSinceLastAttack = 0.0f;
-            std::cout << "Attack successful!" << std::endl;
-        }
-    }
-
-
-    void setupMesh() {
-        float vertices[] = {
-            // Positions                                // Colors           // Texture Coords
-             characterWidth / 2,  characterHeight / 2, 0.0f, 1.0f, 0.0f, 0.0f,   1.0f, 0.0f, // Top Right
-             characterWidth / 2, -characterHeight / 2, 0.0f, 0.0f, 1.0f, 0.0f,   1.0f, 1.0f, // Bottom Right
-            -characterWidth / 2, -characterHeight / 2, 0.0f, 0.0f, 0.0f, 1.0f,   0.0f, 1.0f, // Bottom Left
-            -characterWidth / 2,  characterHeight / 2, 0.0f, 1.0f, 1.0f, 0.0f,   0.0f, 0.0f  // Top Left 
-        };
-
-        unsigned int indices[] = {
-            0, 1, 3,
-            1, 2, 3
-        };
-
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-    }
-
-    float getX() const { return x; }
-    float getY() const { return y; }
-
-    void move(float dx, float dy, float deltaTime) {
-        float newY = y + dy * particleSpeed * deltaTime;
-        float newX = x + dx * particleSpeed * deltaTime;
-        x = newX;
-        y = newY;
-    }
+    int getLiveCount() const { return liveCount; }
 
     void update(float deltaTime) {
         timeSinceLastAttack += deltaTime;
-        // ...  ,   ...
-    }
-
-
-    void drawParticles() {
-        particleShader.Use();
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1); 
-        particleShader.setInt("ourTexture1", 0); 
-
-        glUniform1f(glGetUniformLocation(particleShader.Program, "y_mov"), y);
-        glUniform1f(glGetUniformLocation(particleShader.Program, "x_mov"), x);
-
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
 
-    }
-
-
-    void processInput(GLFWwindow* window, float deltaTime) {
-        float dx = 0;
-        float dy = 0;
+        if (emitting) {
+            spawnAccumulator += spawnRate * deltaTime;
+            while (spawnAccumulator >= 1.0f) {
+                spawnAccumulator -= 1.0f;
+                spawn();
+            }
+        }
 
-        //std::cout <<"X:  " << character->getX() << ",   " << x << ";  Y: " << character->getY() << ",   " << y << std::endl;
+        for (int i = 0; i < liveCount; ++i) {
+            posX[i] += velX[i] * deltaTime;
+            posY[i] += velY[i] * deltaTime;
+            age[i] += deltaTime;
+        }
 
-        if (!isfallsdown) {
-            dx -= 1.0f;
-            if (x < -1.0f || x > 1.0f) {
-                isAlive = false;
+        for (int i = 0; i < liveCount; ) {
+            if (age[i] >= particleLifetime ||
+                posX[i] < boundsMinX || posX[i] > boundsMaxX || posY[i] < boundsMinY || posY[i] > boundsMaxY) {
+                kill(i);
+            }
+            else {
+                ++i;
             }
         }
-        else {
-            dy -= 1.0f;
-            if (y < -1.0f || y > 1.0f) {
-                isAlive = false;
+    }
+
+    void attackPlayer() {
+        if (!character || timeSinceLastAttack < attackCooldown) return;
+
+        float playerLeft = character->getX() - character->getWidth() / 2 - width / 2;
+        float playerRight = character->getX() + character->getWidth() / 2 + width / 2;
+        float playerTop = character->getY() + character->getHeight() / 2 + height / 2;
+        float playerBottom = character->getY() - character->getHeight() / 2 - height / 2;
+
+        for (int i = 0; i < liveCount; ++i) {
+            if (posX[i] > playerLeft && posX[i] < playerRight &&
+                posY[i] > playerBottom && posY[i] < playerTop) {
+                character->takeDamage(damage);
+                timeSinceLastAttack = 0.0f;
+                std::cout << "Attack successful!" << std::endl;
+                break;
             }
         }
+    }
 
-        move(dx, dy, deltaTime);
+    void processInput(const Input& input, float deltaTime) {
         update(deltaTime);
         attackPlayer();
     }
 
-    void restart() {
-            isAlive = true;
-            if (!isfallsdown) {
-                x = startX;
-                y = startY;
-            }
-            else {
-                std::random_device rd;
-                std::mt19937 gen(rd());
-                std::uniform_real_distribution<> dis(-1.0, 0.7);
-
-                double random_number = dis(gen);
-
-                x = random_number;
-                y = startY;
+    // Snapshot layout: one SpriteInstance per particle inside the camera view
+    void draw(RenderQueue& queue) {
+        visible.clear();
+        for (int i = 0; i < liveCount; ++i) {
+            float half = size[i] / 2;
+            if (queue.isVisible(posX[i] - half, posY[i] - half, posX[i] + half, posY[i] + half)) {
+                visible.push_back(i);
             }
+        }
+        int count = static_cast<int>(visible.size());
+        if (count == 0) return;
+
+        float* data = queue.push(RenderLayer::Particles, this, RenderQueue::spriteProgram, frame.texture.id(),
+            count * sizeof(SpriteInstance) / sizeof(float), count);
+        SpriteInstance* out = reinterpret_cast<SpriteInstance*>(data);
+
+        // Fade out over the last fifth of the particle's life (smoothstep)
+        float fadeStart = 0.8f * particleLifetime;
+        float fadeLength = particleLifetime - fadeStart;
+        for (int j = 0; j < count; ++j) {
+            int i = visible[j];
+            float t = fadeLength > 0.0f ? std::min(std::max((age[i] - fadeStart) / fadeLength, 0.0f), 1.0f) : 1.0f;
+            float alpha = 1.0f - t * t * (3.0f - 2.0f * t);
+            out[j] = SpriteInstance(Sprite(posX[i], posY[i], size[i], size[i], frame.texCoords, 0.0f, alpha, frame.shape));
+        }
+    }
 
-            std::cout << "Particle successful!" << std::endl;
-        }    
+    void render(const float* data, uint32_t count) override {
+        SpriteRenderer::getInstance().draw(frame.texture.id(), reinterpret_cast<const SpriteInstance*>(data), count);
+    }
 };
-#endif // PARTICLE_EMITTER_H
\ No newline at end of file
+#endif // PARTICLE_EMITTER_H
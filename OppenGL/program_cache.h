@@ -0,0 +1,255 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "asset_pack.h"
+#include "render_backend.h"
+#include "shader_embed.h"
+#include "shader_sources.h"
+
+// Every program the game draws with, built once per process and shared by all Shader
+// objects made from the same pair of files. Sources come from shader_sources.h, so a
+// release build reads no shader file; files that are not embedded are still loaded.
+//
+// preload() begins the programs a load will need and returns; they are only waited for
+// when first used, so a driver with KHR_parallel_shader_compile builds them while the
+// rest of the load goes on. Linked programs are also saved as driver binaries in
+// <cache dir>/<key>.bin, the key hashing both sources and the driver string, and the next
+// launch on the same driver loads them instead of compiling. A binary the driver rejects
+// is compiled again and overwritten.
+//
+// Render thread only, like every other GL call.
+class ProgramCache {
+public:
+    struct Program {
+        unsigned int id = 0;
+        std::vector<UniformDesc> uniforms;
+    };
+
+    struct Stats {
+        int compiled = 0;            // built from source
+        int loadedBinaries = 0;      // taken from the binary cache
+        int savedBinaries = 0;
+        double seconds = 0.0;        // spent in the backend: compiles, links and binary loads
+    };
+
+private:
+    struct Entry {
+        Program program;
+        ProgramJob job;
+        uint64_t key = 0;
+        bool pending = false;        // begun, not finished
+    };
+
+    struct BinaryHeader {
+        char magic[4];               // "PBIN"
+        uint32_t version;
+        uint32_t format;             // the driver's binary format enum
+        uint32_t size;
+        uint64_t key;
+    };
+
+    static const uint32_t binaryVersion = 1;
+
+    std::map<std::string, Entry> entries;    // "vertex|fragment"
+    std::string cacheDir;
+    std::string driver;
+    bool driverQueried;
+    Stats stats;
+
+    ProgramCache() : cacheDir("shadercache"), driverQueried(false) {}
+
+    class Timer {
+        double& total;
+        std::chrono::steady_clock::time_point start;
+    public:
+        explicit Timer(double& total) : total(total), start(std::chrono::steady_clock::now()) {}
+        ~Timer() { total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+    };
+
+    // FNV-1a, 64 bit; the terminator separates fields
+    static uint64_t hashString(uint64_t hash, const std::string& text) {
+        for (size_t i = 0; i <= text.size(); ++i) {
+            hash ^= static_cast<unsigned char>(text.c_str()[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Empty when the backend cannot hand out binaries; the disk cache is off then
+    const std::string& driverString() {
+        if (!driverQueried) {
+            driver = RenderBackend::get().getDriverString();
+            driverQueried = true;
+        }
+        return driver;
+    }
+
+    bool diskCacheEnabled() {
+        return !cacheDir.empty() && !driverString().empty();
+    }
+
+    std::string binaryPath(uint64_t key) const {
+        std::ostringstream path;
+        path << cacheDir << "/" << std::hex << key << ".bin";
+        return path.str();
+    }
+
+    unsigned int loadBinary(uint64_t key, std::vector<UniformDesc>& uniforms) {
+        std::ifstream file(binaryPath(key), std::ios::binary);
+        BinaryHeader header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return 0;
+        if (std::memcmp(header.magic, "PBIN", 4) != 0 || header.version != binaryVersion || header.key != key) return 0;
+
+        std::vector<unsigned char> binary(header.size);
+        if (!file.read(reinterpret_cast<char*>(binary.data()), header.size)) return 0;
+        return RenderBackend::get().createProgramFromBinary(header.format, binary, uniforms);
+    }
+
+    // A file cut short by a crash fails the size check on load and is simply rewritten
+    bool saveBinary(uint64_t key, unsigned int program) {
+        uint32_t format = 0;
+        std::vector<unsigned char> binary;
+        if (!RenderBackend::get().getProgramBinary(program, format, binary)) return false;
+
+#ifdef _WIN32
+        _mkdir(cacheDir.c_str());
+#else
+        mkdir(cacheDir.c_str(), 0755);
+#endif
+        std::ofstream file(binaryPath(key), std::ios::binary | std::ios::trunc);
+        BinaryHeader header = { { 'P', 'B', 'I', 'N' }, binaryVersion, format, static_cast<uint32_t>(binary.size()), key };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+        return static_cast<bool>(file);
+    }
+
+    // The embedded copy. When the file next to the game was edited since, every build says
+    // so, as shader_sources.h is not regenerated by the build; debug builds then take the file.
+    // Shaders that are not embedded come from the asset pack or their loose file.
+    static bool loadSource(const std::string& path, std::string& source) {
+        const char* embedded = EmbeddedShaders::find(path.c_str());
+        if (embedded) {
+            std::ifstream file(path, std::ios::binary);
+            if (file) {
+                std::string loose = ShaderEmbedder::normalize(
+                    std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+                if (loose != embedded) {
+#ifndef NDEBUG
+                    std::cerr << "Shader: '" << path << "' differs from its embedded copy, run --embed-shaders" << std::endl;
+                    source = loose;
+                    return true;
+#else
+                    std::cerr << "Shader: '" << path << "' differs from its embedded copy, which this build uses;"
+                        " run --embed-shaders and rebuild" << std::endl;
+#endif
+                }
+            }
+        }
+        if (embedded) {
+            source = embedded;
+            return true;
+        }
+        AssetData file;
+        if (!AssetPack::getInstance().load(path, file)) return false;
+        source = file.str();
+        return true;
+    }
+
+    Entry& begin(const std::string& vertexPath, const std::string& fragmentPath) {
+        std::string name = vertexPath + "|" + fragmentPath;
+        auto it = entries.find(name);
+        if (it != entries.end()) return it->second;
+        Entry& entry = entries[name];
+
+        // Nothing is compiled without both sources; the program stays 0
+        if (!loadSource(vertexPath, entry.job.vertexSource) || !loadSource(fragmentPath, entry.job.fragmentSource)) {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << vertexPath << ", " << fragmentPath << std::endl;
+            entry.job = ProgramJob();
+            return entry;
+        }
+
+        Timer timer(stats.seconds);
+        if (diskCacheEnabled()) {
+            uint64_t key = hashString(14695981039346656037ull, std::to_string(binaryVersion));
+            key = hashString(key, entry.job.vertexSource);
+            key = hashString(key, entry.job.fragmentSource);
+            entry.key = hashString(key, driverString());
+
+            entry.program.id = loadBinary(entry.key, entry.program.uniforms);
+            if (entry.program.id) {
+                ++stats.loadedBinaries;
+                return entry;
+            }
+        }
+        RenderBackend::get().beginProgram(entry.job);
+        entry.pending = true;
+        return entry;
+    }
+
+    void finish(Entry& entry) {
+        if (!entry.pending) return;
+        entry.pending = false;
+        {
+            Timer timer(stats.seconds);
+            entry.program.id = RenderBackend::get().finishProgram(entry.job, entry.program.uniforms);
+        }
+        ++stats.compiled;
+        if (entry.program.id && diskCacheEnabled() && saveBinary(entry.key, entry.program.id)) {
+            ++stats.savedBinaries;
+        }
+        // The sources are only needed until the program is built
+        entry.job = ProgramJob();
+    }
+
+public:
+    static ProgramCache& getInstance() {
+        static ProgramCache instance;
+        return instance;
+    }
+
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    // Where binaries are kept; empty turns the disk cache off. Set it before the first program.
+    void setCacheDirectory(const std::string& dir) { cacheDir = dir; }
+
+    // Begins every (vertex, fragment) pair not built yet and returns without waiting
+    void preload(const std::vector<std::pair<std::string, std::string>>& programs) {
+        for (const auto& program : programs) begin(program.first, program.second);
+    }
+
+    // Waits for everything preload() began
+    void finishAll() {
+        for (auto& entry : entries) finish(entry.second);
+    }
+
+    // The program built from the two files, compiling it on first use; id 0 if it failed
+    const Program& get(const std::string& vertexPath, const std::string& fragmentPath) {
+        Entry& entry = begin(vertexPath, fragmentPath);
+        finish(entry);
+        return entry.program;
+    }
+
+    const Stats& getStats() const { return stats; }
+};
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,65 @@
+#ifndef QUAD_MESH_H
+#define QUAD_MESH_H
+
+#include <glad/glad.h>
+
+#include "gl_state.h"
+#include "render_backend.h"
+
+// Geometry every sprite path shares instead of owning its own VAO/VBO/EBO triple:
+// the sprite outline, 8 vertices that only carry their corner number and a fan of
+// 6 triangles over them. Instanced draws take each corner's position from the
+// per-instance outline (see SpriteShape); a plain quad leaves 4 of the triangles
+// empty, which the GPU drops before rasterizing.
+// The buffers live as long as the GL context; it frees them on shutdown.
+class QuadMesh {
+private:
+    unsigned int outlineVBO, outlineEBO;
+
+    QuadMesh() {
+        float corners[] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+        // A fan from corner 0; the 4th triangle starts at corner 4 so that a plain quad
+        // is drawn as exactly the two triangles the unit quad was (TL TR BR, BR BL TL)
+        unsigned int indices[] = {
+            0, 1, 2,
+            0, 2, 3,
+            0, 3, 4,
+            4, 5, 0,
+            0, 5, 6,
+            0, 6, 7
+        };
+
+        RenderBackend& backend = RenderBackend::get();
+        outlineVBO = backend.createBuffer();
+        outlineEBO = backend.createBuffer();
+
+        GLState& gl = GLState::getInstance();
+        gl.bindBuffer(GL_ARRAY_BUFFER, outlineVBO);
+        backend.bufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+        // Uploading through GL_ARRAY_BUFFER keeps whatever VAO is bound untouched
+        gl.bindBuffer(GL_ARRAY_BUFFER, outlineEBO);
+        backend.bufferData(GL_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    }
+
+public:
+    static const int outlineIndexCount = 18;
+
+    static QuadMesh& getInstance() {
+        static QuadMesh instance;
+        return instance;
+    }
+
+    QuadMesh(const QuadMesh&) = delete;
+    QuadMesh& operator=(const QuadMesh&) = delete;
+
+    // Attaches the sprite outline to the bound VAO, the corner number at cornerLocation
+    void attachOutline(GLuint cornerLocation) {
+        GLState& gl = GLState::getInstance();
+        gl.bindBuffer(GL_ARRAY_BUFFER, outlineVBO);
+        RenderBackend::get().vertexAttribute(cornerLocation, 1, sizeof(float), 0, 0);
+        gl.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, outlineEBO);
+    }
+};
+
+#endif // QUAD_MESH_H
@@ -0,0 +1,417 @@
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <iostream>
+
+enum class TextureFilter {
+    Nearest,   // sprite sheets: always RGBA, no filtering between texels
+    Linear     // backgrounds and effects: native channel count, trilinear
+};
+
+struct TextureDesc {
+    int width, height;
+    int channels;          // 1, 3 or 4
+    TextureFilter filter;
+    bool mipmaps;
+    bool clampToEdge;      // otherwise repeat
+};
+
+// GPU block-compressed formats, every one in 4x4 texel blocks
+enum class CompressedFormat {
+    BC1,        // RGB with 1-bit alpha, 8 bytes per block (DXT1)
+    BC3,        // RGBA, 16 bytes per block (DXT5)
+    ETC2_RGB,   // RGB, 8 bytes per block
+    ETC2_RGBA   // EAC alpha + ETC2 RGB, 16 bytes per block
+};
+
+// Compressed texels of every mip level, level 0 first, rows top to bottom like stb_image
+struct CompressedImage {
+    CompressedFormat format;
+    int width, height;
+    std::vector<std::vector<unsigned char>> levels;
+};
+
+// One active uniform of a linked program
+struct UniformDesc {
+    std::string name;
+    GLint location;
+    GLenum type;
+    GLint size;
+};
+
+// A program on its way through the driver, see RenderBackend::beginProgram
+struct ProgramJob {
+    std::string vertexSource, fragmentSource;
+    unsigned int program = 0;                      // backend name once begun, 0 if it failed
+    unsigned int vertexStage = 0, fragmentStage = 0;
+};
+
+// Everything the renderer asks of the graphics API. The game never calls GL itself:
+// resources are created here, binds go through GLState (which only forwards the binds
+// that change something) and draws are issued here.
+//
+// GLBackend talks to OpenGL, NullBackend does nothing and RecordingBackend logs every
+// call, so levels can run without a window or a context.
+// Enums and types are GL's, they are just names for the other backends.
+class RenderBackend {
+private:
+    static std::unique_ptr<RenderBackend>& slot() {
+        static std::unique_ptr<RenderBackend> backend;
+        return backend;
+    }
+
+public:
+    virtual ~RenderBackend() = default;
+
+    // The backend every renderer object uses; install one before creating any of them
+    static RenderBackend& get() { return *slot(); }
+    static void set(std::unique_ptr<RenderBackend> backend) { slot() = std::move(backend); }
+
+    virtual const char* getName() const = 0;
+    virtual int getMaxTextureSize() const = 0;
+
+    // Resources
+    // pixels may be null for a texture filled later through updateTextureRows
+    virtual unsigned int createTexture(const TextureDesc& desc, const unsigned char* pixels) = 0;
+    // Same result as createTexture, for uploads spread over frames: a backend may stage the
+    // pixels so the call returns before the copy into the texture has happened
+    virtual unsigned int createTextureStreamed(const TextureDesc& desc, const unsigned char* pixels) {
+        return createTexture(desc, pixels);
+    }
+    // Writes rows [y, y + rows) of an uncompressed texture, pixels pointing at row y; for images
+    // too large to upload in one frame. The mip chain is rebuilt once the last row is in.
+    virtual void updateTextureRows(unsigned int id, const TextureDesc& desc, int y, int rows, const unsigned char* pixels) = 0;
+    // desc gives the filter and wrap mode; the mip chain comes with the image
+    virtual unsigned int createCompressedTexture(const TextureDesc& desc, const CompressedImage& image) = 0;
+    virtual bool supportsCompressedFormat(CompressedFormat format) const = 0;
+    virtual void deleteTexture(unsigned int id) = 0;
+    virtual unsigned int createBuffer() = 0;
+    virtual void bufferData(GLenum target, size_t bytes, const void* data, GLenum usage) = 0;  // into the bound buffer
+    virtual void deleteBuffer(unsigned int id) = 0;
+    virtual unsigned int createVertexArray() = 0;
+    virtual void deleteVertexArray(unsigned int id) = 0;
+    // Float attribute of the bound VAO, read from the bound GL_ARRAY_BUFFER
+    virtual void vertexAttribute(GLuint location, int components, size_t stride, size_t offset, GLuint divisor) = 0;
+    // Returns 0 if the program does not compile or link; uniforms receives its active uniforms
+    virtual unsigned int createProgram(const std::string& vertexSource, const std::string& fragmentSource,
+        std::vector<UniformDesc>& uniforms) = 0;
+    virtual void deleteProgram(unsigned int id) = 0;
+
+    // createProgram in two steps: beginProgram() hands the sources to the driver and returns,
+    // finishProgram() waits for the result (0 on failure, like createProgram). A driver with
+    // KHR_parallel_shader_compile builds everything begun in between concurrently.
+    // By default the whole job runs in finishProgram().
+    virtual void beginProgram(ProgramJob&) {}
+    virtual unsigned int finishProgram(ProgramJob& job, std::vector<UniformDesc>& uniforms) {
+        job.program = createProgram(job.vertexSource, job.fragmentSource, uniforms);
+        return job.program;
+    }
+
+    // Driver binaries of linked programs (ARB_get_program_binary). A binary only loads on the
+    // driver that wrote it, getDriverString() names that driver; it is empty when the backend
+    // has no binaries, and then these two always fail.
+    virtual std::string getDriverString() { return std::string(); }
+    virtual bool getProgramBinary(unsigned int, uint32_t&, std::vector<unsigned char>&) { return false; }
+    // 0 if the driver rejects the binary (another driver version, say)
+    virtual unsigned int createProgramFromBinary(uint32_t, const std::vector<unsigned char>&,
+        std::vector<UniformDesc>&) { return 0; }
+
+    // GPU timers (GL_TIME_ELAPSED queries), one running at a time. timerResult() never waits:
+    // it is false until the GPU has finished the timed commands. Backends that cannot
+    // time anything return 0 from createTimer().
+    virtual unsigned int createTimer() { return 0; }
+    virtual void deleteTimer(unsigned int) {}
+    virtual void beginTimer(unsigned int) {}
+    virtual void endTimer() {}
+    virtual bool timerResult(unsigned int, uint64_t&) { return false; }
+
+    // Per-frame vertex data: copies bytes into the stream buffer and returns their offset.
+    // One call takes at most maxStreamUpload bytes, callers split anything larger; a frame
+    // is expected to stream at most streamFrameBudget bytes in all, which is what the GL
+    // ring keeps per frame in flight. Returns streamUploadFailed for data it cannot take.
+    static const size_t maxStreamUpload = 2 * 1024 * 1024;
+    static const size_t streamFrameBudget = 8 * 1024 * 1024;
+    static const size_t streamUploadFailed = ~static_cast<size_t>(0);
+    virtual size_t streamUpload(const void* data, size_t bytes, size_t alignment) = 0;
+    virtual unsigned int streamBuffer() = 0;
+
+    // State, reached through GLState
+    virtual void useProgram(unsigned int id) = 0;
+    virtual void bindVertexArray(unsigned int id) = 0;
+    virtual void bindBuffer(GLenum target, unsigned int id) = 0;
+    virtual void activeTexture(unsigned int unit) = 0;
+    virtual void bindTexture(unsigned int id) = 0;
+    virtual void setBlend(bool enabled) = 0;
+    virtual void blendFunc(GLenum src, GLenum dst) = 0;
+
+    // Uniforms of the program in use
+    virtual void setUniform(GLint location, int value) = 0;
+    virtual void setUniform(GLint location, float value) = 0;
+    virtual void setUniform(GLint location, float x, float y) = 0;
+    virtual void setUniform(GLint location, float x, float y, float z) = 0;
+    virtual void setUniform(GLint location, float x, float y, float z, float w) = 0;
+
+    // Drawing
+    virtual void setViewport(int x, int y, int width, int height) = 0;
+    virtual void clear(float r, float g, float b) = 0;
+    virtual void drawIndexed(GLenum mode, int indexCount, int baseVertex) = 0;
+    virtual void drawIndexedInstanced(GLenum mode, int indexCount, int instanceCount) = 0;
+    virtual void drawArrays(GLenum mode, int first, int count) = 0;
+
+    // Called once per frame after the swap
+    virtual void endFrame() {}
+    virtual void printStats() const {}
+};
+
+// Accepts everything and draws nothing. Object names are handed out like GL would,
+// and uniforms are found by scanning the shader sources, so shaders still resolve
+// their handles without warnings.
+class NullBackend : public RenderBackend {
+protected:
+    unsigned int nextId;
+    size_t streamHead;
+
+    static GLenum uniformType(const std::string& type) {
+        if (type == "float") return GL_FLOAT;
+        if (type == "int") return GL_INT;
+        if (type == "vec2") return GL_FLOAT_VEC2;
+        if (type == "vec3") return GL_FLOAT_VEC3;
+        if (type == "vec4") return GL_FLOAT_VEC4;
+        if (type == "sampler2D") return GL_SAMPLER_2D;
+        if (type == "mat4") return GL_FLOAT_MAT4;
+        return 0;
+    }
+
+    // "uniform <type> <name>;" declarations, one per statement
+    static void scanUniforms(const std::string& source, std::vector<UniformDesc>& uniforms) {
+        std::istringstream stream(source);
+        std::string word;
+        while (stream >> word) {
+            if (word != "uniform") continue;
+            std::string type, name;
+            stream >> type >> name;
+            name = name.substr(0, name.find_first_of(";["));
+            bool known = false;
+            for (const auto& uniform : uniforms) known = known || uniform.name == name;
+            if (!known && !name.empty()) {
+                uniforms.push_back({ name, static_cast<GLint>(uniforms.size()), uniformType(type), 1 });
+            }
+        }
+    }
+
+public:
+    NullBackend() : nextId(1), streamHead(0) {}
+
+    const char* getName() const override { return "null"; }
+    int getMaxTextureSize() const override { return 16384; }
+
+    unsigned int createTexture(const TextureDesc&, const unsigned char*) override { return nextId++; }
+    void updateTextureRows(unsigned int, const TextureDesc&, int, int, const unsigned char*) override {}
+    unsigned int createCompressedTexture(const TextureDesc&, const CompressedImage&) override { return nextId++; }
+    bool supportsCompressedFormat(CompressedFormat) const override { return true; }
+    void deleteTexture(unsigned int) override {}
+    unsigned int createBuffer() override { return nextId++; }
+    void bufferData(GLenum, size_t, const void*, GLenum) override {}
+    void deleteBuffer(unsigned int) override {}
+    unsigned int createVertexArray() override { return nextId++; }
+    void deleteVertexArray(unsigned int) override {}
+    void vertexAttribute(GLuint, int, size_t, size_t, GLuint) override {}
+
+    unsigned int createProgram(const std::string& vertexSource, const std::string& fragmentSource,
+        std::vector<UniformDesc>& uniforms) override {
+        uniforms.clear();
+        scanUniforms(vertexSource, uniforms);
+        scanUniforms(fragmentSource, uniforms);
+        return nextId++;
+    }
+    void deleteProgram(unsigned int) override {}
+
+    size_t streamUpload(const void*, size_t bytes, size_t alignment) override {
+        if (bytes > maxStreamUpload) return streamUploadFailed;
+        size_t offset = (streamHead + alignment - 1) / alignment * alignment;
+        streamHead = offset + bytes;
+        return offset;
+    }
+    unsigned int streamBuffer() override { return 0; }
+
+    void useProgram(unsigned int) override {}
+    void bindVertexArray(unsigned int) override {}
+    void bindBuffer(GLenum, unsigned int) override {}
+    void activeTexture(unsigned int) override {}
+    void bindTexture(unsigned int) override {}
+    void setBlend(bool) override {}
+    void blendFunc(GLenum, GLenum) override {}
+
+    void setUniform(GLint, int) override {}
+    void setUniform(GLint, float) override {}
+    void setUniform(GLint, float, float) override {}
+    void setUniform(GLint, float, float, float) override {}
+    void setUniform(GLint, float, float, float, float) override {}
+
+    void setViewport(int, int, int, int) override {}
+    void clear(float, float, float) override {}
+    void drawIndexed(GLenum, int, int) override {}
+    void drawIndexedInstanced(GLenum, int, int) override {}
+    void drawArrays(GLenum, int, int) override {}
+
+    void endFrame() override { streamHead = 0; }
+};
+
+// A NullBackend that writes down what the frame asked for: every state change and draw
+// of the last frame as a readable log, plus counters that tests and benchmarks can check.
+class RecordingBackend : public NullBackend {
+public:
+    struct Counters {
+        int drawCalls = 0;
+        int stateChanges = 0;      // program, VAO, buffer, texture and blend changes
+        int uniformSets = 0;
+        int64_t primitives = 0;    // triangles or lines, instances included
+        size_t bytesStreamed = 0;
+        int resourcesCreated = 0;
+    };
+
+private:
+    std::vector<std::string> frameLog;
+    std::vector<std::string> lastFrameLog;
+    Counters frameCounters;
+    Counters lastFrameCounters;
+    Counters totalCounters;
+    int frames;
+
+    template<typename... Args>
+    void record(const char* call, Args... args) {
+        std::ostringstream line;
+        line << call << '(';
+        const char* separator = "";
+        using expand = int[];
+        (void)expand{ 0, ((line << separator << args, separator = ", "), 0)... };
+        line << ')';
+        frameLog.push_back(line.str());
+    }
+
+    void stateChange() {
+        ++frameCounters.stateChanges;
+    }
+
+    void draw(GLenum mode, int64_t vertices) {
+        ++frameCounters.drawCalls;
+        frameCounters.primitives += mode == GL_LINES ? vertices / 2 : vertices / 3;
+    }
+
+public:
+    RecordingBackend() : frames(0) {}
+
+    const char* getName() const override { return "recording"; }
+
+    unsigned int createTexture(const TextureDesc& desc, const unsigned char* pixels) override {
+        unsigned int id = NullBackend::createTexture(desc, pixels);
+        ++frameCounters.resourcesCreated;
+        record("createTexture", id, desc.width, desc.height, desc.channels);
+        return id;
+    }
+    void updateTextureRows(unsigned int id, const TextureDesc& desc, int y, int rows, const unsigned char* pixels) override {
+        NullBackend::updateTextureRows(id, desc, y, rows, pixels);
+        record("updateTextureRows", id, y, rows);
+    }
+    unsigned int createCompressedTexture(const TextureDesc& desc, const CompressedImage& image) override {
+        unsigned int id = NullBackend::createCompressedTexture(desc, image);
+        ++frameCounters.resourcesCreated;
+        record("createCompressedTexture", id, image.width, image.height, static_cast<int>(image.format), image.levels.size());
+        return id;
+    }
+    unsigned int createBuffer() override {
+        ++frameCounters.resourcesCreated;
+        return NullBackend::createBuffer();
+    }
+    unsigned int createVertexArray() override {
+        ++frameCounters.resourcesCreated;
+        return NullBackend::createVertexArray();
+    }
+    unsigned int createProgram(const std::string& vertexSource, const std::string& fragmentSource,
+        std::vector<UniformDesc>& uniforms) override {
+        unsigned int id = NullBackend::createProgram(vertexSource, fragmentSource, uniforms);
+        ++frameCounters.resourcesCreated;
+        record("createProgram", id, uniforms.size());
+        return id;
+    }
+
+    size_t streamUpload(const void* data, size_t bytes, size_t alignment) override {
+        size_t offset = NullBackend::streamUpload(data, bytes, alignment);
+        frameCounters.bytesStreamed += bytes;
+        record("streamUpload", bytes, offset);
+        return offset;
+    }
+
+    void useProgram(unsigned int id) override { stateChange(); record("useProgram", id); }
+    void bindVertexArray(unsigned int id) override { stateChange(); record("bindVertexArray", id); }
+    void bindBuffer(GLenum target, unsigned int id) override { stateChange(); record("bindBuffer", target, id); }
+    void activeTexture(unsigned int unit) override { stateChange(); record("activeTexture", unit); }
+    void bindTexture(unsigned int id) override { stateChange(); record("bindTexture", id); }
+    void setBlend(bool enabled) override { stateChange(); record("setBlend", enabled); }
+    void blendFunc(GLenum src, GLenum dst) override { stateChange(); record("blendFunc", src, dst); }
+
+    void setUniform(GLint location, int value) override { ++frameCounters.uniformSets; record("setUniform", location, value); }
+    void setUniform(GLint location, float x) override { ++frameCounters.uniformSets; record("setUniform", location, x); }
+    void setUniform(GLint location, float x, float y) override { ++frameCounters.uniformSets; record("setUniform", location, x, y); }
+    void setUniform(GLint location, float x, float y, float z) override { ++frameCounters.uniformSets; record("setUniform", location, x, y, z); }
+    void setUniform(GLint location, float x, float y, float z, float w) override { ++frameCounters.uniformSets; record("setUniform", location, x, y, z, w); }
+
+    void clear(float r, float g, float b) override { record("clear", r, g, b); }
+
+    void drawIndexed(GLenum mode, int indexCount, int baseVertex) override {
+        draw(mode, indexCount);
+        record("drawIndexed", mode, indexCount, baseVertex);
+    }
+    void drawIndexedInstanced(GLenum mode, int indexCount, int instanceCount) override {
+        draw(mode, static_cast<int64_t>(indexCount) * instanceCount);
+        record("drawIndexedInstanced", mode, indexCount, instanceCount);
+    }
+    void drawArrays(GLenum mode, int first, int count) override {
+        draw(mode, count);
+        record("drawArrays", mode, first, count);
+    }
+
+    void endFrame() override {
+        NullBackend::endFrame();
+        lastFrameLog.swap(frameLog);
+        frameLog.clear();
+        lastFrameCounters = frameCounters;
+
+        totalCounters.drawCalls += frameCounters.drawCalls;
+        totalCounters.stateChanges += frameCounters.stateChanges;
+        totalCounters.uniformSets += frameCounters.uniformSets;
+        totalCounters.primitives += frameCounters.primitives;
+        totalCounters.bytesStreamed += frameCounters.bytesStreamed;
+        totalCounters.resourcesCreated += frameCounters.resourcesCreated;
+        frameCounters = Counters();
+        ++frames;
+    }
+
+    const std::vector<std::string>& getLastFrameLog() const { return lastFrameLog; }
+    const Counters& getLastFrameCounters() const { return lastFrameCounters; }
+    const Counters& getTotalCounters() const { return totalCounters; }
+    int getFrameCount() const { return frames; }
+
+    void printStats() const override {
+        std::cout << "Recorded frame: " << lastFrameCounters.drawCalls << " draw calls, "
+            << lastFrameCounters.stateChanges << " state changes, "
+            << lastFrameCounters.uniformSets << " uniform sets, "
+            << lastFrameCounters.primitives << " primitives, "
+            << lastFrameCounters.bytesStreamed / 1024 << " KB streamed" << std::endl;
+    }
+
+    void dumpLastFrame(std::ostream& out) const {
+        for (const auto& line : lastFrameLog) {
+            out << line << '\n';
+        }
+    }
+};
+
+#endif // RENDER_BACKEND_H
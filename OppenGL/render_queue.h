@@ -0,0 +1,245 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "sprite_batch.h"
+#include "camera.h"
+#include "render_backend.h"
+#include "render_stats.h"
+
+// Draw order buckets, lowest first. Inside a layer commands are grouped by shader and
+// texture; depth only orders commands that share both. Each layer is timed as the
+// RenderPass of the same number.
+enum class RenderLayer : uint8_t {
+    Background = 0,   // ground, walls, platforms
+    World = 1,        // characters, arm, enemies
+    Decals = 2,       // bullet traces
+    Particles = 3,
+    Overlay = 4       // crosshair, debug output
+};
+static_assert(static_cast<int>(RenderLayer::Overlay) + 1 == RenderStats::passCount, "one RenderPass per layer");
+
+// Anything that issues its own draw (instanced emitters, line meshes, ...).
+// render() runs during RenderQueue::submit, after the sprites sorted before it were flushed.
+// It may only use the data it copied into the queue when it was pushed and GL objects
+// that do not change after construction: submit can run while the simulation moves on.
+class Drawable {
+public:
+    virtual void render(const float* data, uint32_t count) = 0;
+    virtual ~Drawable() = default;
+};
+
+// Per-frame list of draw commands, a self-contained snapshot of what the frame shows.
+// Game code pushes in whatever order it runs; submit() radix-sorts the 64-bit keys
+// and then replays the commands with the fewest program and texture switches:
+//
+//   63..56 layer | 55..48 shader slot | 47..32 texture | 31..0 depth
+//
+// Depth defaults to the push order, so equal keys keep the order they were pushed in.
+//
+// With a camera set, sprites outside its view (plus a margin) are dropped at push time,
+// before they cost a command or any GL work; drawables test isVisible() themselves.
+class RenderQueue {
+private:
+    enum class CommandType : uint32_t { Sprite, Drawable };
+
+    struct Command {
+        uint64_t key;
+        CommandType type;
+        uint32_t payload;   // index into sprites or drawables
+    };
+
+    struct SpriteCommand {
+        unsigned int texture;
+        Sprite sprite;
+    };
+
+    struct DrawableCommand {
+        Drawable* drawable;
+        uint32_t dataOffset;   // into drawableData
+        uint32_t count;
+    };
+
+    // Shader slot 0 is the sprite program; other programs get slots as they are first seen.
+    // The key has 8 bits for it, so programs past the 255th all share slot 255: they still
+    // draw correctly, only their grouping in the sort is lost.
+    static const uint32_t spriteShaderSlot = 0;
+    static const uint32_t maxShaderSlot = 0xFF;
+
+    std::vector<Command> commands;
+    std::vector<Command> scratch;
+    std::vector<SpriteCommand> sprites;
+    std::vector<DrawableCommand> drawables;
+    std::vector<float> drawableData;
+    std::vector<GLuint> shaderSlots;
+    uint32_t sequence;
+    float clearR, clearG, clearB;
+    float viewProjection[4];
+    ViewRect visible;
+    uint32_t culled;
+
+    uint32_t shaderSlot(GLuint program) {
+        if (program == spriteProgram) return spriteShaderSlot;
+        for (size_t i = 0; i < shaderSlots.size(); ++i) {
+            if (shaderSlots[i] == program) return static_cast<uint32_t>(i + 1);
+        }
+        if (shaderSlots.size() >= maxShaderSlot) return maxShaderSlot;
+        shaderSlots.push_back(program);
+        return static_cast<uint32_t>(shaderSlots.size());
+    }
+
+    static uint64_t makeKey(RenderLayer layer, uint32_t shader, unsigned int texture, uint32_t depth) {
+        return (static_cast<uint64_t>(layer) << 56) |
+            (static_cast<uint64_t>(shader & 0xFF) << 48) |
+            (static_cast<uint64_t>(texture & 0xFFFF) << 32) |
+            depth;
+    }
+
+    // LSD radix sort, one byte per pass; passes where every key has the same byte are skipped
+    void sortCommands() {
+        size_t count = commands.size();
+        scratch.resize(count);
+
+        for (int shift = 0; shift < 64; shift += 8) {
+            size_t histogram[256] = {};
+            for (const Command& command : commands) {
+                ++histogram[(command.key >> shift) & 0xFF];
+            }
+            if (histogram[(commands[0].key >> shift) & 0xFF] == count) continue;
+
+            size_t offset = 0;
+            for (int bucket = 0; bucket < 256; ++bucket) {
+                size_t n = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += n;
+            }
+            for (const Command& command : commands) {
+                scratch[histogram[(command.key >> shift) & 0xFF]++] = command;
+            }
+            commands.swap(scratch);
+        }
+    }
+
+public:
+    // Pass as the program of drawables that draw with SpriteRenderer, so they sort with the sprites
+    static const GLuint spriteProgram = 0;
+
+    RenderQueue() : sequence(0), clearR(0.0f), clearG(0.0f), clearB(0.0f),
+        viewProjection{ 1.0f, 1.0f, 0.0f, 0.0f }, visible(ViewRect::unbounded()), culled(0) {
+        commands.reserve(1024);
+        sprites.reserve(1024);
+    }
+
+    // Starts a new frame
+    void clear() {
+        commands.clear();
+        sprites.clear();
+        drawables.clear();
+        drawableData.clear();
+        sequence = 0;
+        clearR = clearG = clearB = 0.0f;
+        viewProjection[0] = viewProjection[1] = 1.0f;
+        viewProjection[2] = viewProjection[3] = 0.0f;
+        visible = ViewRect::unbounded();
+        culled = 0;
+    }
+
+    // World transform and cull rectangle of this frame; set it before pushing.
+    // margin keeps things that are about to scroll in from popping at the edge.
+    void setCamera(const Camera2D& camera, float margin = 0.25f) {
+        camera.getViewProjection(viewProjection);
+        visible = camera.getViewRect(margin);
+    }
+
+    bool isVisible(float minX, float minY, float maxX, float maxY) const {
+        return visible.intersects(minX, minY, maxX, maxY);
+    }
+
+    void setClearColor(float r, float g, float b) {
+        clearR = r;
+        clearG = g;
+        clearB = b;
+    }
+
+    void push(RenderLayer layer, unsigned int texture, const Sprite& sprite) {
+        // Half the diagonal bounds the sprite at any rotation; screen-space sprites are always in view
+        float radius = 0.5f * std::sqrt(sprite.width * sprite.width + sprite.height * sprite.height);
+        if (!(sprite.flags & SpriteFlag::ScreenSpace) &&
+            !isVisible(sprite.x - radius, sprite.y - radius, sprite.x + radius, sprite.y + radius)) {
+            ++culled;
+            return;
+        }
+
+        Command command;
+        command.key = makeKey(layer, spriteShaderSlot, texture, sequence++);
+        command.type = CommandType::Sprite;
+        command.payload = static_cast<uint32_t>(sprites.size());
+        commands.push_back(command);
+        sprites.push_back({ texture, sprite });
+    }
+
+    // program and texture only steer the sort, the drawable binds its own state.
+    // Returns room for dataSize floats that render() receives back together with count;
+    // fill it right away, the pointer is only valid until the next push.
+    float* push(RenderLayer layer, Drawable* drawable, GLuint program, unsigned int texture,
+        size_t dataSize, uint32_t count) {
+        Command command;
+        command.key = makeKey(layer, shaderSlot(program), texture, sequence++);
+        command.type = CommandType::Drawable;
+        command.payload = static_cast<uint32_t>(drawables.size());
+        commands.push_back(command);
+
+        uint32_t offset = static_cast<uint32_t>(drawableData.size());
+        drawables.push_back({ drawable, offset, count });
+        drawableData.resize(offset + dataSize);
+        return drawableData.data() + offset;
+    }
+
+    void submit(SpriteBatch& batch) {
+        if (!commands.empty()) {
+            sortCommands();
+        }
+
+        // The overdraw view adds up from black
+        if (SpriteRenderer::getInstance().isOverdraw()) RenderBackend::get().clear(0.0f, 0.0f, 0.0f);
+        else RenderBackend::get().clear(clearR, clearG, clearB);
+        Shader::setViewProjection(viewProjection);
+
+        RenderStats& stats = RenderStats::getInstance();
+        uint64_t currentLayer = ~0ull;
+        batch.begin();
+        for (const Command& command : commands) {
+            // Sorted by layer, so every pass is one stretch of commands
+            uint64_t layer = command.key >> 56;
+            if (layer != currentLayer) {
+                batch.flush();
+                stats.beginPass(static_cast<RenderPass>(layer));
+                currentLayer = layer;
+            }
+            if (command.type == CommandType::Sprite) {
+                const SpriteCommand& sprite = sprites[command.payload];
+                batch.draw(sprite.texture, sprite.sprite);
+            }
+            else {
+                // Sprites sorted before this draw have to reach GL first
+                batch.flush();
+                const DrawableCommand& draw = drawables[command.payload];
+                draw.drawable->render(drawableData.data() + draw.dataOffset, draw.count);
+            }
+        }
+        batch.end();
+        stats.endPass();
+    }
+
+    size_t size() const { return commands.size(); }
+
+    // Sprites dropped by the view test this frame
+    uint32_t getCulledCount() const { return culled; }
+};
+
+#endif // RENDER_QUEUE_H
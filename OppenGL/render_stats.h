@@ -0,0 +1,241 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "gl_state.h"
+#include "render_backend.h"
+
+// The parts a frame's GPU time is split into. RenderQueue::submit() maps its layers onto
+// them, so every command of a layer is timed by the same pass.
+enum class RenderPass : uint8_t {
+    Level = 0,       // static level geometry
+    Entities = 1,    // characters, arm, enemies
+    Decals = 2,      // bullet traces
+    Particles = 3,
+    Crosshair = 4    // and the rest of the overlay layer
+};
+
+// What the render thread did per frame: draws, triangles, binds and uploaded bytes, plus
+// the GPU time of each RenderPass measured with timer queries (GL_TIME_ELAPSED).
+//
+// Each pass owns one query per frame in flight, two sets used in turn. A frame's results
+// are collected when its set comes round again, a frame later, and only if the GPU has
+// them ready; a late result is dropped rather than waited for, so reading the timers
+// never stalls the pipeline. Results also go into a history of the last few seconds to
+// average over.
+//
+// Render thread only: read it from a job (RenderThread::post) or after the thread stopped.
+// Queries live as long as the context, like QuadMesh.
+class RenderStats {
+public:
+    static const int passCount = 5;
+    static const int historyLength = 240;   // 4 s at 60 Hz
+
+    struct Counters {
+        int drawCalls = 0;
+        int64_t triangles = 0;        // instances included
+        int programBinds = 0;         // binds that reached the backend, see GLState
+        int textureBinds = 0;
+        int vertexArrayBinds = 0;
+        size_t bytesUploaded = 0;     // stream buffer and texture uploads
+    };
+
+    // GPU milliseconds of each pass; negative where the pass did not run or no result came back
+    struct PassTimes {
+        float milliseconds[passCount];
+        PassTimes() { for (float& ms : milliseconds) ms = -1.0f; }
+    };
+
+private:
+    static const int querySets = 2;
+
+    Counters frameCounters;
+    Counters lastFrameCounters;
+    Counters totalCounters;
+    int frames;
+
+    unsigned int queries[querySets][passCount];
+    bool issued[querySets][passCount];
+    int querySet;                 // the set this frame writes
+    int activePass;               // -1 between passes
+    bool queriesCreated;
+    bool timersAvailable;
+
+    PassTimes latest;
+    std::vector<PassTimes> history;   // ring of historyLength
+    size_t historyHead;
+
+    RenderStats() : frames(0), querySet(0), activePass(-1), queriesCreated(false), timersAvailable(false), historyHead(0) {
+        for (int set = 0; set < querySets; ++set) {
+            for (int pass = 0; pass < passCount; ++pass) {
+                queries[set][pass] = 0;
+                issued[set][pass] = false;
+            }
+        }
+        history.reserve(historyLength);
+    }
+
+    // Created on the first pass, on the thread that owns the context
+    void createQueries() {
+        queriesCreated = true;
+        RenderBackend& backend = RenderBackend::get();
+        timersAvailable = true;
+        for (int set = 0; set < querySets; ++set) {
+            for (int pass = 0; pass < passCount; ++pass) {
+                queries[set][pass] = backend.createTimer();
+                if (!queries[set][pass]) timersAvailable = false;
+            }
+        }
+    }
+
+    // Results of the set about to be reused; whatever is not ready yet is lost
+    void collect(int set) {
+        PassTimes times;
+        bool any = false;
+        for (int pass = 0; pass < passCount; ++pass) {
+            if (!issued[set][pass]) continue;
+            issued[set][pass] = false;
+            uint64_t nanoseconds = 0;
+            if (RenderBackend::get().timerResult(queries[set][pass], nanoseconds)) {
+                times.milliseconds[pass] = static_cast<float>(nanoseconds / 1e6);
+                latest.milliseconds[pass] = times.milliseconds[pass];
+                any = true;
+            }
+        }
+        if (!any) return;
+        if (history.size() < static_cast<size_t>(historyLength)) {
+            history.push_back(times);
+        }
+        else {
+            history[historyHead] = times;
+            historyHead = (historyHead + 1) % historyLength;
+        }
+    }
+
+public:
+    static RenderStats& getInstance() {
+        static RenderStats instance;
+        return instance;
+    }
+
+    RenderStats(const RenderStats&) = delete;
+    RenderStats& operator=(const RenderStats&) = delete;
+
+    static const char* passName(RenderPass pass) {
+        static const char* names[passCount] = { "level", "entities", "decals", "particles", "crosshair" };
+        return names[static_cast<int>(pass)];
+    }
+
+    // Every draw of the frame reports here
+    void recordDraw(GLenum mode, int indexCount, int instanceCount) {
+        ++frameCounters.drawCalls;
+        if (mode == GL_TRIANGLES) frameCounters.triangles += static_cast<int64_t>(indexCount / 3) * instanceCount;
+    }
+
+    void recordUpload(size_t bytes) { frameCounters.bytesUploaded += bytes; }
+
+    // Ends the running pass, if any, and starts timing pass. Nesting is not possible,
+    // GL only runs one GL_TIME_ELAPSED query at a time.
+    void beginPass(RenderPass pass) {
+        endPass();
+        if (!queriesCreated) createQueries();
+        if (!timersAvailable) return;
+        int index = static_cast<int>(pass);
+        // A pass that comes back in the same frame keeps the time it had so far
+        if (issued[querySet][index]) return;
+        RenderBackend::get().beginTimer(queries[querySet][index]);
+        issued[querySet][index] = true;
+        activePass = index;
+    }
+
+    void endPass() {
+        if (activePass < 0) return;
+        RenderBackend::get().endTimer();
+        activePass = -1;
+    }
+
+    // Called once per frame after the swap and GLState::endFrame()
+    void endFrame() {
+        endPass();
+
+        const GLState::Stats& binds = GLState::getInstance().getLastFrameStats();
+        frameCounters.programBinds = binds.programBinds;
+        frameCounters.textureBinds = binds.textureBinds;
+        frameCounters.vertexArrayBinds = binds.vertexArrayBinds;
+        lastFrameCounters = frameCounters;
+
+        totalCounters.drawCalls += frameCounters.drawCalls;
+        totalCounters.triangles += frameCounters.triangles;
+        totalCounters.programBinds += frameCounters.programBinds;
+        totalCounters.textureBinds += frameCounters.textureBinds;
+        totalCounters.vertexArrayBinds += frameCounters.vertexArrayBinds;
+        totalCounters.bytesUploaded += frameCounters.bytesUploaded;
+        frameCounters = Counters();
+        ++frames;
+
+        querySet = (querySet + 1) % querySets;
+        collect(querySet);
+    }
+
+    const Counters& getLastFrameCounters() const { return lastFrameCounters; }
+    const Counters& getTotalCounters() const { return totalCounters; }
+    int getFrameCount() const { return frames; }
+
+    // False when the backend has no timers; every time below is negative then
+    bool hasTimers() const { return timersAvailable; }
+
+    // The most recent result of each pass, a frame or two behind the counters
+    const PassTimes& getLatestPassTimes() const { return latest; }
+
+    // Mean over the frames in the history that have a result for the pass, -1 if none
+    float getAverageMilliseconds(RenderPass pass) const {
+        int index = static_cast<int>(pass);
+        double sum = 0.0;
+        int samples = 0;
+        for (const PassTimes& times : history) {
+            if (times.milliseconds[index] < 0.0f) continue;
+            sum += times.milliseconds[index];
+            ++samples;
+        }
+        return samples > 0 ? static_cast<float>(sum / samples) : -1.0f;
+    }
+
+    // Oldest first
+    std::vector<PassTimes> getHistory() const {
+        std::vector<PassTimes> ordered(history.begin() + historyHead, history.end());
+        ordered.insert(ordered.end(), history.begin(), history.begin() + historyHead);
+        return ordered;
+    }
+
+    void printStats() const {
+        const Counters& last = lastFrameCounters;
+        std::cout << "Render stats: " << last.drawCalls << " draws, " << last.triangles << " triangles, "
+            << last.programBinds << " program / " << last.textureBinds << " texture / "
+            << last.vertexArrayBinds << " VAO binds, " << last.bytesUploaded / 1024 << " KB uploaded" << std::endl;
+        printPassTimes();
+    }
+
+    // "GPU: level 0.120 ms, ..." averaged over the history; nothing without timers
+    void printPassTimes() const {
+        if (!timersAvailable || history.empty()) return;
+        std::ios::fmtflags flags = std::cout.flags();
+        std::cout << "GPU (" << history.size() << " frames):" << std::fixed << std::setprecision(3);
+        float total = 0.0f;
+        for (int pass = 0; pass < passCount; ++pass) {
+            float ms = getAverageMilliseconds(static_cast<RenderPass>(pass));
+            if (ms < 0.0f) continue;
+            std::cout << " " << passName(static_cast<RenderPass>(pass)) << " " << ms << " ms,";
+            total += ms;
+        }
+        std::cout << " total " << total << " ms" << std::endl;
+        std::cout.flags(flags);
+    }
+};
+
+#endif // RENDER_STATS_H
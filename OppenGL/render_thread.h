@@ -0,0 +1,167 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "gl_state.h"
+#include "render_backend.h"
+#include "sprite_batch.h"
+#include "render_queue.h"
+#include "render_stats.h"
+#include "stats_overlay.h"
+#include "texture_streamer.h"
+
+// Owns the GL context (if there is one) and draws on its own thread.
+//
+// The simulation fills frameQueue() and hands it over with publish(). The three queues
+// rotate through a lock-free triple buffer: the simulation writes one, the render thread
+// reads another and the third holds the latest published frame. publish() returns as soon
+// as the render thread has picked up the frame, so the next frame is simulated while
+// this one is submitted and swapped.
+//
+// Everything else that needs GL (loading a level, creating textures and shaders, resizing
+// the viewport) is a job: invoke() runs it on the render thread between two frames and
+// waits for it, post() queues it and returns.
+class RenderThread {
+private:
+    static const int freshBit = 4;   // set in 'middle' when it holds an unread frame
+
+    GLFWwindow* window;
+    std::thread thread;
+    std::atomic<bool> running;
+
+    RenderQueue queues[3];
+    int writeIndex;                 // simulation side
+    int readIndex;                  // render side
+    std::atomic<int> middle;        // index of the third queue | freshBit
+    uint64_t publishedFrame;
+    std::atomic<uint64_t> consumedFrame;
+    uint64_t frameNumbers[3];
+
+    std::mutex jobMutex;
+    std::condition_variable jobDone;
+    std::deque<std::function<void()>> jobs;
+    uint64_t jobsQueued;
+    uint64_t jobsFinished;
+
+    std::unique_ptr<SpriteBatch> spriteBatch;
+
+    void runJobs() {
+        std::unique_lock<std::mutex> lock(jobMutex);
+        while (!jobs.empty()) {
+            std::function<void()> job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+            ++jobsFinished;
+        }
+        jobDone.notify_all();
+    }
+
+    bool takeFrame() {
+        if (!(middle.load(std::memory_order_acquire) & freshBit)) return false;
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & ~freshBit;
+        consumedFrame.store(frameNumbers[readIndex], std::memory_order_release);
+        return true;
+    }
+
+    void run() {
+        if (window) glfwMakeContextCurrent(window);
+        spriteBatch.reset(new SpriteBatch());
+
+        while (running.load()) {
+            runJobs();
+
+            if (!takeFrame()) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+
+            // Streamed textures become resident between frames, a budget's worth at a time
+            TextureStreamer::getInstance().pump();
+            queues[readIndex].submit(*spriteBatch);
+            StatsOverlay::getInstance().draw(*spriteBatch);
+            if (window) glfwSwapBuffers(window);
+            GLState::getInstance().endFrame();
+            RenderStats::getInstance().endFrame();
+            RenderBackend::get().endFrame();
+        }
+
+        runJobs();
+        spriteBatch.reset();
+        if (window) glfwMakeContextCurrent(NULL);
+    }
+
+public:
+    RenderThread()
+        : window(nullptr), running(false), writeIndex(0), readIndex(1), middle(2),
+        publishedFrame(0), consumedFrame(0), jobsQueued(0), jobsFinished(0)
+    {
+        frameNumbers[0] = frameNumbers[1] = frameNumbers[2] = 0;
+    }
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // The context must be current on the calling thread; it moves to the render thread.
+    // Without a window the thread drives whatever backend is installed and never swaps.
+    void start(GLFWwindow* win) {
+        window = win;
+        if (window) glfwMakeContextCurrent(NULL);
+        running = true;
+        thread = std::thread(&RenderThread::run, this);
+    }
+
+    void stop() {
+        if (!running.load()) return;
+        running = false;
+        thread.join();
+    }
+
+    RenderQueue& frameQueue() {
+        return queues[writeIndex];
+    }
+
+    // Hands the frame to the render thread and waits until it has been picked up
+    void publish() {
+        frameNumbers[writeIndex] = ++publishedFrame;
+        writeIndex = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel) & ~freshBit;
+        while (running.load() && consumedFrame.load(std::memory_order_acquire) < publishedFrame) {
+            std::this_thread::yield();
+        }
+        queues[writeIndex].clear();
+    }
+
+    // Runs job on the render thread and returns once it has finished
+    void invoke(std::function<void()> job) {
+        std::unique_lock<std::mutex> lock(jobMutex);
+        jobs.push_back(std::move(job));
+        uint64_t ticket = ++jobsQueued;
+        jobDone.wait(lock, [&] { return jobsFinished >= ticket; });
+    }
+
+    // Queues job for the render thread without waiting
+    void post(std::function<void()> job) {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobs.push_back(std::move(job));
+        ++jobsQueued;
+    }
+
+    ~RenderThread() {
+        stop();
+    }
+};
+
+#endif // RENDER_THREAD_H
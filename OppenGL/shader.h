@@ -4,118 +4,187 @@
 #include <glad/glad.h>
 
 #include <string>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 #include <GLFW/glfw3.h>
 
-class Shader 
-{
-public:
-	GLuint Program;
-
-	void setVec4(const std::string& name, float x, float y, float z, float w) const
-	{
-		glUniform4f(glGetUniformLocation(Program, name.c_str()), x, y, z, w);
-	}
-
-	
-
-	Shader(const GLchar* vertexPath, const GLchar* fragmentPath) {
-
-		std::string vertexCode;
-		std::string fragmentCode;
-		std::ifstream vShaderFile;
-		std::ifstream fShaderFile;
-
-		vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-		try {
-
-			vShaderFile.open(vertexPath);
-			fShaderFile.open(fragmentPath);
-
-			std::stringstream vShaderStream, fShaderStream;
-
-			vShaderStream << vShaderFile.rdbuf();
-			fShaderStream << fShaderFile.rdbuf();
-
-			vShaderFile.close();
-			fShaderFile.close();
-
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
-
-
-		}
-		catch (std::ifstream::failure e) {
-			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-		}
-
-		const GLchar* vShaderCode = vertexCode.c_str();
-		const GLchar* fShaderCode = fragmentCode.c_str();
-
+#include "gl_state.h"
+#include "program_cache.h"
+#include "render_backend.h"
 
+// Pre-resolved uniform locations. Resolve them once with Shader::uniform<T>(name)
+// and keep them next to the shader; set() is a single uniform call on the bound program.
+// A handle for a missing uniform has location -1, which every backend silently ignores.
+struct UniformHandle {
+    GLint location = -1;
+    bool valid() const { return location != -1; }
+};
 
-		GLuint vertex, fragment;
-		GLint success;
-		GLchar infoLog[512];
-
-
-		vertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex, 1, &vShaderCode, NULL);
-		glCompileShader(vertex);
-
-		glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-		if (!success) {
-			glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::VERTEX::COMPILETION_FAILED\n" << infoLog << std::endl;
-		}
-
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &fShaderCode, NULL);
-		glCompileShader(fragment);
-
-		glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-		if (!success) {
-			glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::FRAGMENT::COMPILETION_FAILED\n" << infoLog << std::endl;
-		}
-
-		this->Program = glCreateProgram();
-		glAttachShader(this->Program, vertex);
-		glAttachShader(this->Program, fragment);
-		glLinkProgram(this->Program);
-
-		glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+struct UniformInt : UniformHandle {
+    static const GLenum glType = GL_INT;
+    void set(int value) const { RenderBackend::get().setUniform(location, value); }
+};
 
-		if (!success) {
-			glGetProgramInfoLog(this->Program, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::PROGRAM::LINKETION_FAILED\n" << infoLog << std::endl;
-		}
+struct UniformSampler : UniformHandle {
+    static const GLenum glType = GL_SAMPLER_2D;
+    void set(int unit) const { RenderBackend::get().setUniform(location, unit); }
+};
 
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
+struct UniformFloat : UniformHandle {
+    static const GLenum glType = GL_FLOAT;
+    void set(float value) const { RenderBackend::get().setUniform(location, value); }
+};
 
+struct UniformVec2 : UniformHandle {
+    static const GLenum glType = GL_FLOAT_VEC2;
+    void set(float x, float y) const { RenderBackend::get().setUniform(location, x, y); }
+};
 
+struct UniformVec3 : UniformHandle {
+    static const GLenum glType = GL_FLOAT_VEC3;
+    void set(float x, float y, float z) const { RenderBackend::get().setUniform(location, x, y, z); }
+};
 
-	}
+struct UniformVec4 : UniformHandle {
+    static const GLenum glType = GL_FLOAT_VEC4;
+    void set(float x, float y, float z, float w) const { RenderBackend::get().setUniform(location, x, y, z, w); }
+};
 
+// The handle type for a uniform's GL type, for the generated slots in shader_sources.h
+template<GLenum Type> struct UniformHandleFor;
+template<> struct UniformHandleFor<GL_INT> { typedef UniformInt type; };
+template<> struct UniformHandleFor<GL_SAMPLER_2D> { typedef UniformSampler type; };
+template<> struct UniformHandleFor<GL_FLOAT> { typedef UniformFloat type; };
+template<> struct UniformHandleFor<GL_FLOAT_VEC2> { typedef UniformVec2 type; };
+template<> struct UniformHandleFor<GL_FLOAT_VEC3> { typedef UniformVec3 type; };
+template<> struct UniformHandleFor<GL_FLOAT_VEC4> { typedef UniformVec4 type; };
 
-	void Use() { glUseProgram(this->Program);  };
+class Shader 
+{
+private:
+    struct UniformInfo {
+        GLint location;
+        GLenum type;
+        GLint size;
+    };
+
+    // Every active uniform of the linked program, as reported by the backend
+    std::unordered_map<std::string, UniformInfo> uniforms;
+
+    // Camera transform shared by every program that declares "uniform vec4 viewProjection".
+    // The version changes with the value, so each program re-uploads it only when it is stale.
+    struct ViewState {
+        float viewProjection[4];
+        unsigned int version;
+    };
+
+    static ViewState& viewState() {
+        static ViewState state = { { 1.0f, 1.0f, 0.0f, 0.0f }, 1 };
+        return state;
+    }
+
+    UniformVec4 viewProjectionUniform;
+    unsigned int viewVersion = 0;
+
+    // The generated slots of an embedded program (shader_sources.h) and their locations,
+    // by slot index; -1 where the linked program lacks the uniform or has another type
+    const EmbeddedUniform* slotTable = nullptr;
+    std::vector<GLint> slotLocations;
 
-	void setInt(const char* uniformName, int value) {
-		glUseProgram(Program);
-		GLint location = glGetUniformLocation(Program, uniformName);
-		if (location != -1) {
-			glUniform1i(location, value);
-		}
-		else {
-			std::cerr << "Warning: Uniform '" << uniformName << "' not found in shader program." << std::endl;
-		}
-	}
+public:
+    GLuint Program;
+
+    // The program belongs to ProgramCache: every Shader over the same two files shares it,
+    // and only the first one compiles (or loads a cached binary)
+    Shader(const GLchar* vertexPath, const GLchar* fragmentPath) {
+        const ProgramCache::Program& program = ProgramCache::getInstance().get(vertexPath, fragmentPath);
+        this->Program = program.id;
+        for (const UniformDesc& desc : program.uniforms) {
+            uniforms[desc.name] = { desc.location, desc.type, desc.size };
+        }
+        // Screen-space programs do not declare it; that is not worth a warning
+        if (hasUniform("viewProjection")) {
+            viewProjectionUniform = uniform<UniformVec4>("viewProjection");
+        }
+
+        int slotCount = 0;
+        slotTable = EmbeddedShaders::findUniforms(vertexPath, slotCount);
+        slotLocations.assign(slotCount, -1);
+        for (int i = 0; i < slotCount; ++i) {
+            auto it = uniforms.find(slotTable[i].name);
+            if (it == uniforms.end()) continue;
+            if (it->second.type != slotTable[i].type) {
+                std::cerr << "Warning: Uniform '" << slotTable[i].name << "' has a different type in the shader program"
+                    " than in its embedded copy, run --embed-shaders." << std::endl;
+                continue;
+            }
+            slotLocations[i] = it->second.location;
+        }
+    }
+
+
+    void Use() {
+        GLState::getInstance().useProgram(this->Program);
+        const ViewState& view = viewState();
+        if (viewProjectionUniform.valid() && viewVersion != view.version) {
+            const float* vp = view.viewProjection;
+            viewProjectionUniform.set(vp[0], vp[1], vp[2], vp[3]);
+            viewVersion = view.version;
+        }
+    };
+
+    // World to clip transform for every program: clip = world * (x, y) + (z, w).
+    // Render thread only, like Use().
+    static void setViewProjection(const float viewProjection[4]) {
+        ViewState& view = viewState();
+        if (std::equal(viewProjection, viewProjection + 4, view.viewProjection)) return;
+        std::copy(viewProjection, viewProjection + 4, view.viewProjection);
+        ++view.version;
+    }
+
+    bool hasUniform(const char* uniformName) const {
+        return uniforms.count(uniformName) != 0;
+    }
+
+    // Looks the uniform up in the reflected table; call at setup time, not per frame.
+    // Warns once here if the uniform is missing or declared with another type.
+    template<typename Handle>
+    Handle uniform(const char* uniformName) const {
+        Handle handle;
+        auto it = uniforms.find(uniformName);
+        if (it == uniforms.end()) {
+            std::cerr << "Warning: Uniform '" << uniformName << "' not found in shader program." << std::endl;
+            return handle;
+        }
+        if (it->second.type != Handle::glType) {
+            std::cerr << "Warning: Uniform '" << uniformName << "' has a different type in the shader program." << std::endl;
+            return handle;
+        }
+        handle.location = it->second.location;
+        return handle;
+    }
+
+    // The handle for a generated slot, e.g. uniform<SpriteProgram::Uniform::viewProjection>():
+    // the handle type is fixed when the game is built and the location was resolved with
+    // the program, so this is an array read with no name lookup
+    template<typename Slot>
+    typename UniformHandleFor<Slot::type>::type uniform() const {
+        typename UniformHandleFor<Slot::type>::type handle;
+        if (slotTable != Slot::Program::uniforms()) {
+            std::cerr << "Warning: Uniform slot '" << Slot::name() << "' belongs to another shader program." << std::endl;
+            return handle;
+        }
+        handle.location = slotLocations[Slot::index];
+        if (!handle.valid()) {
+            std::cerr << "Warning: Uniform '" << Slot::name() << "' not found in shader program." << std::endl;
+        }
+        return handle;
+    }
 
 
 };
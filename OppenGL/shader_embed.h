@@ -0,0 +1,235 @@
+#ifndef SHADER_EMBED_H
+#define SHADER_EMBED_H
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Writes shader_sources.h: for every program the GLSL of both stages as string literals,
+// its attribute locations as constants and its uniforms as typed slots, so code names
+// them as SpriteProgram::Uniform::viewProjection instead of a string and a typo or a
+// type change no longer builds (see Shader::uniform<Slot>()). Each slot is an index into
+// the program's uniform table, which Shader resolves to locations once when it is created.
+//
+// Run by main --embed-shaders after editing a .glsl file. Every build warns at startup
+// when an embedded copy no longer matches its file (see ProgramCache::loadSource).
+class ShaderEmbedder {
+private:
+    struct Declaration {
+        std::string type, name;
+        int location;
+    };
+
+    // Raw string pieces stay well below MSVC's limit for a single literal
+    static const size_t maxPiece = 4096;
+
+    static bool readFile(const std::string& path, std::string& out) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+        out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+public:
+    // Line endings as the compiler sees them inside a raw literal, whatever git checked out
+    static std::string normalize(std::string source) {
+        source.erase(std::remove(source.begin(), source.end(), '\r'), source.end());
+        return source;
+    }
+
+    // "vertex_sprite.glsl" -> "SpriteProgram"
+    static std::string programName(const std::string& vertexPath) {
+        std::string name = vertexPath.substr(0, vertexPath.rfind('.'));
+        if (name.compare(0, 7, "vertex_") == 0) name.erase(0, 7);
+        if (!name.empty()) name[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(name[0])));
+        return name + "Program";
+    }
+
+private:
+    // Handle enums Shader::uniform<Slot>() knows; anything else cannot be given a slot
+    static const char* glType(const std::string& type) {
+        if (type == "int") return "GL_INT";
+        if (type == "float") return "GL_FLOAT";
+        if (type == "vec2") return "GL_FLOAT_VEC2";
+        if (type == "vec3") return "GL_FLOAT_VEC3";
+        if (type == "vec4") return "GL_FLOAT_VEC4";
+        if (type == "sampler2D") return "GL_SAMPLER_2D";
+        return nullptr;
+    }
+
+    // "layout (location = N) in <type> <name>;" and "uniform <type> <name>;", comments skipped
+    static void scan(const std::string& source, std::vector<Declaration>& attributes,
+        std::vector<Declaration>& uniforms, bool vertexStage) {
+        std::string code;
+        std::istringstream lines(source);
+        std::string line;
+        while (std::getline(lines, line)) {
+            code += line.substr(0, line.find("//")) + "\n";
+        }
+        for (char& ch : code) {
+            if (ch == '(' || ch == ')' || ch == '=' || ch == ';') ch = ' ';
+        }
+
+        std::istringstream stream(code);
+        std::string word;
+        while (stream >> word) {
+            if (word == "layout" && vertexStage) {
+                std::string qualifier, direction, type, name;
+                int location = -1;
+                if (stream >> qualifier >> location >> direction >> type >> name &&
+                    qualifier == "location" && direction == "in") {
+                    attributes.push_back({ type, name, location });
+                }
+            }
+            else if (word == "uniform") {
+                std::string type, name;
+                stream >> type >> name;
+                uniforms.push_back({ type, name.substr(0, name.find('[')), -1 });
+            }
+        }
+    }
+
+    static bool writeLiteral(std::ostream& out, const std::string& path, const std::string& source) {
+        if (source.find(")glsl\"") != std::string::npos) {
+            std::cerr << "Embed: '" << path << "' contains the literal's delimiter" << std::endl;
+            return false;
+        }
+        size_t begin = 0;
+        do {
+            size_t end = std::min(source.size(), begin + maxPiece);
+            if (end < source.size()) end = source.rfind('\n', end - 1) + 1;
+            if (end <= begin) end = std::min(source.size(), begin + maxPiece);
+            out << "R\"glsl(" << source.substr(begin, end - begin) << ")glsl\"";
+            begin = end;
+            if (begin < source.size()) out << "\n        ";
+        } while (begin < source.size());
+        return true;
+    }
+
+public:
+    // Rewrites outputPath only when its contents change, so the build does not redo
+    // every file that includes it
+    static bool write(const std::vector<std::pair<std::string, std::string>>& programs, const std::string& outputPath) {
+        std::ostringstream out;
+        out << "// Generated by \"OppenGL --embed-shaders\" from the .glsl files (see shader_embed.h). Do not edit.\n"
+            << "#ifndef SHADER_SOURCES_H\n#define SHADER_SOURCES_H\n\n"
+            << "#include <glad/glad.h>\n\n#include <cstring>\n\n"
+            << "// A uniform slot of an embedded program, resolved by Shader when the program is created\n"
+            << "struct EmbeddedUniform {\n    const char* name;\n    GLenum type;\n};\n\n";
+
+        std::vector<std::string> names, paths, sources;
+        for (const auto& program : programs) {
+            std::string vertexSource, fragmentSource;
+            if (!readFile(program.first, vertexSource) || !readFile(program.second, fragmentSource)) {
+                std::cerr << "Embed: cannot read '" << program.first << "' or '" << program.second << "'" << std::endl;
+                return false;
+            }
+            vertexSource = normalize(vertexSource);
+            fragmentSource = normalize(fragmentSource);
+
+            std::vector<Declaration> attributes, uniforms, fragmentUniforms, unused;
+            scan(vertexSource, attributes, uniforms, true);
+            scan(fragmentSource, unused, fragmentUniforms, false);
+            for (const Declaration& uniform : fragmentUniforms) {
+                bool known = false;
+                for (const Declaration& other : uniforms) {
+                    if (other.name != uniform.name) continue;
+                    known = true;
+                    if (other.type != uniform.type) {
+                        std::cerr << "Embed: uniform '" << uniform.name << "' has two types in " << programName(program.first) << std::endl;
+                        return false;
+                    }
+                }
+                if (!known) uniforms.push_back(uniform);
+            }
+
+            std::string name = programName(program.first);
+            out << "// " << program.first << " + " << program.second << "\n"
+                << "struct " << name << " {\n"
+                << "    static constexpr const char* vertexPath = \"" << program.first << "\";\n"
+                << "    static constexpr const char* fragmentPath = \"" << program.second << "\";\n\n"
+                << "    static constexpr const char* vertexSource =\n        ";
+            if (!writeLiteral(out, program.first, vertexSource)) return false;
+            out << ";\n\n    static constexpr const char* fragmentSource =\n        ";
+            if (!writeLiteral(out, program.second, fragmentSource)) return false;
+            out << ";\n\n    // Vertex attribute locations\n";
+            for (const Declaration& attribute : attributes) {
+                out << "    static const GLuint " << attribute.name << " = " << attribute.location << ";\n";
+            }
+            out << "\n    // Uniform slots for Shader::uniform<Slot>(), indices into uniforms()\n    struct Uniform {\n";
+            std::ostringstream table;
+            for (size_t i = 0; i < uniforms.size(); ++i) {
+                const Declaration& uniform = uniforms[i];
+                const char* type = glType(uniform.type);
+                if (!type) {
+                    std::cerr << "Embed: uniform '" << uniform.name << "' of " << name
+                        << " has a type without a handle (" << uniform.type << ")" << std::endl;
+                    return false;
+                }
+                out << "        struct " << uniform.name << " {\n"
+                    << "            typedef " << name << " Program;\n"
+                    << "            static const int index = " << i << ";\n"
+                    << "            static const char* name() { return \"" << uniform.name << "\"; }\n"
+                    << "            static const GLenum type = " << type << ";\n"
+                    << "        };\n";
+                table << "            { \"" << uniform.name << "\", " << type << " },\n";
+            }
+            out << "    };\n\n"
+                << "    static const int uniformCount = " << uniforms.size() << ";\n\n"
+                << "    static const EmbeddedUniform* uniforms() {\n";
+            if (uniforms.empty()) {
+                out << "        return nullptr;\n";
+            }
+            else {
+                out << "        static const EmbeddedUniform table[uniformCount] = {\n" << table.str()
+                    << "        };\n        return table;\n";
+            }
+            out << "    }\n};\n\n";
+
+            names.push_back(name);
+            paths.push_back(program.first);
+            sources.push_back(name + "::vertexSource");
+            paths.push_back(program.second);
+            sources.push_back(name + "::fragmentSource");
+        }
+
+        out << "// Embedded source of a shader file, null for files that are not embedded\n"
+            << "struct EmbeddedShaders {\n"
+            << "    static const char* find(const char* path) {\n";
+        for (size_t i = 0; i < paths.size(); ++i) {
+            out << "        if (std::strcmp(path, \"" << paths[i] << "\") == 0) return " << sources[i] << ";\n";
+        }
+        out << "        return nullptr;\n    }\n\n"
+            << "    // Uniform slots of the program whose vertex stage is path; null and 0 if it has none\n"
+            << "    static const EmbeddedUniform* findUniforms(const char* vertexPath, int& count) {\n";
+        for (size_t i = 0; i < names.size(); ++i) {
+            out << "        if (std::strcmp(vertexPath, " << names[i] << "::vertexPath) == 0) {\n"
+                << "            count = " << names[i] << "::uniformCount;\n"
+                << "            return " << names[i] << "::uniforms();\n"
+                << "        }\n";
+        }
+        out << "        count = 0;\n        return nullptr;\n    }\n};\n\n#endif // SHADER_SOURCES_H\n";
+
+        std::string previous;
+        if (readFile(outputPath, previous) && previous == out.str()) {
+            std::cout << "Embed: " << outputPath << " is up to date" << std::endl;
+            return true;
+        }
+        std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+        file << out.str();
+        if (!file) {
+            std::cerr << "Embed: cannot write '" << outputPath << "'" << std::endl;
+            return false;
+        }
+        std::cout << "Embed: wrote " << outputPath << " (" << programs.size() << " programs)" << std::endl;
+        return true;
+    }
+};
+
+#endif // SHADER_EMBED_H
@@ -0,0 +1,147 @@
+// Generated by "OppenGL --embed-shaders" from the .glsl files (see shader_embed.h). Do not edit.
+#ifndef SHADER_SOURCES_H
+#define SHADER_SOURCES_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// A uniform slot of an embedded program, resolved by Shader when the program is created
+struct EmbeddedUniform {
+    const char* name;
+    GLenum type;
+};
+
+// vertex_sprite.glsl + fragment_sprite.glsl
+struct SpriteProgram {
+    static constexpr const char* vertexPath = "vertex_sprite.glsl";
+    static constexpr const char* fragmentPath = "fragment_sprite.glsl";
+
+    static constexpr const char* vertexSource =
+        R"glsl(#version 330 core
+layout (location = 0) in float aCorner;   // which corner of the outline, 0..7
+
+// Per-sprite instance attributes
+layout (location = 1) in vec4 aOffset;    // xy: centre, z: flags (1 screen space, 2 untextured)
+layout (location = 2) in vec4 aAxes;      // columns of the rotation/scale matrix
+layout (location = 3) in vec4 aTexRect;   // left u, top v, right u, bottom v
+layout (location = 4) in vec4 aColor;
+layout (location = 5) in vec4 aShape01;   // outline corners, 0..1 from the sprite's top-left,
+layout (location = 6) in vec4 aShape23;   // two per attribute; a whole frame is its four corners
+layout (location = 7) in vec4 aShape45;   // with every second one repeated
+layout (location = 8) in vec4 aShape67;
+
+// Camera: clip = world * viewProjection.xy + viewProjection.zw
+uniform vec4 viewProjection;
+
+out vec2 TexCoord;
+out vec4 ourColor;
+flat out int untextured;
+
+void main()
+{
+    int flags = int(aOffset.z);
+    int corner = int(aCorner);
+    vec4 pair = corner < 2 ? aShape01 : corner < 4 ? aShape23 : corner < 6 ? aShape45 : aShape67;
+    vec2 t = (corner & 1) == 0 ? pair.xy : pair.zw;
+
+    vec2 world = aOffset.xy + mat2(aAxes.xy, aAxes.zw) * vec2(t.x - 0.5, 0.5 - t.y);
+    if ((flags & 1) == 0)
+        world = world * viewProjection.xy + viewProjection.zw;
+    gl_Position = vec4(world, 0.0, 1.0);
+    TexCoord = mix(aTexRect.xy, aTexRect.zw, t);
+    ourColor = aColor;
+    untextured = flags & 2;
+})glsl";
+
+    static constexpr const char* fragmentSource =
+        R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec4 ourColor;
+flat in int untextured;
+
+uniform sampler2D ourTexture1;
+uniform int overdraw;   // 1: add a fixed step for every shaded fragment, discarded ones included
+
+void main()
+{
+    if (overdraw != 0) {
+        FragColor = vec4(0.1, 0.04, 0.01, 1.0);
+        return;
+    }
+
+    vec4 texColor = untextured != 0 ? vec4(1.0) : texture(ourTexture1, TexCoord);
+
+    if(texColor.a < 0.1)
+        discard;
+
+    FragColor = texColor * ourColor;
+})glsl";
+
+    // Vertex attribute locations
+    static const GLuint aCorner = 0;
+    static const GLuint aOffset = 1;
+    static const GLuint aAxes = 2;
+    static const GLuint aTexRect = 3;
+    static const GLuint aColor = 4;
+    static const GLuint aShape01 = 5;
+    static const GLuint aShape23 = 6;
+    static const GLuint aShape45 = 7;
+    static const GLuint aShape67 = 8;
+
+    // Uniform slots for Shader::uniform<Slot>(), indices into uniforms()
+    struct Uniform {
+        struct viewProjection {
+            typedef SpriteProgram Program;
+            static const int index = 0;
+            static const char* name() { return "viewProjection"; }
+            static const GLenum type = GL_FLOAT_VEC4;
+        };
+        struct ourTexture1 {
+            typedef SpriteProgram Program;
+            static const int index = 1;
+            static const char* name() { return "ourTexture1"; }
+            static const GLenum type = GL_SAMPLER_2D;
+        };
+        struct overdraw {
+            typedef SpriteProgram Program;
+            static const int index = 2;
+            static const char* name() { return "overdraw"; }
+            static const GLenum type = GL_INT;
+        };
+    };
+
+    static const int uniformCount = 3;
+
+    static const EmbeddedUniform* uniforms() {
+        static const EmbeddedUniform table[uniformCount] = {
+            { "viewProjection", GL_FLOAT_VEC4 },
+            { "ourTexture1", GL_SAMPLER_2D },
+            { "overdraw", GL_INT },
+        };
+        return table;
+    }
+};
+
+// Embedded source of a shader file, null for files that are not embedded
+struct EmbeddedShaders {
+    static const char* find(const char* path) {
+        if (std::strcmp(path, "vertex_sprite.glsl") == 0) return SpriteProgram::vertexSource;
+        if (std::strcmp(path, "fragment_sprite.glsl") == 0) return SpriteProgram::fragmentSource;
+        return nullptr;
+    }
+
+    // Uniform slots of the program whose vertex stage is path; null and 0 if it has none
+    static const EmbeddedUniform* findUniforms(const char* vertexPath, int& count) {
+        if (std::strcmp(vertexPath, SpriteProgram::vertexPath) == 0) {
+            count = SpriteProgram::uniformCount;
+            return SpriteProgram::uniforms();
+        }
+        count = 0;
+        return nullptr;
+    }
+};
+
+#endif // SHADER_SOURCES_H
@@ -0,0 +1,960 @@
+#ifndef SOFTWARE_BACKEND_H
+#define SOFTWARE_BACKEND_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "render_backend.h"
+#include "texture_compress.h"
+
+// Reference rasterizer: draws the game into a CPU framebuffer, no GPU required.
+// Used for golden-image checksums and offscreen thumbnails.
+//
+// It does not run GLSL. Programs are recognised by the attribute and uniform names the
+// sprite shader uses and emulated with the same math:
+//  - corner "aCorner" of the outline in "aShape01".."aShape67", mirrored with "aTexRect",
+//    multiplied by the "aAxes" matrix and moved by "aOffset".xy
+//  - texture coordinates: the same corner mapped into the "aTexRect" rectangle
+//  - tint "aColor"
+//  - flags in "aOffset".z: 1 skips "viewProjection", 2 draws the tint untextured
+// Fragments sample "ourTexture1", are discarded below alpha 0.1, multiplied by the tint
+// and blended with SRC_ALPHA, ONE_MINUS_SRC_ALPHA when blending is on. The tint is taken
+// flat from the first vertex of each triangle; every quad the game draws has a constant tint.
+//
+// Triangles are set up in 28.4 fixed point with a top-left fill rule, so the two halves
+// of a quad never touch a pixel twice. Modulation, blending and clears work on whole
+// spans with SSE2 (AVX2 when the build enables it) using exact integer arithmetic, so a
+// frame gives the same bytes on every machine.
+class SoftwareBackend : public NullBackend {
+public:
+    // Fragments per pixel of the last frame, see setOverdrawCounting()
+    struct Overdraw {
+        int64_t fragments = 0;
+        int64_t coveredPixels = 0;   // shaded at least once
+        int maxLayers = 0;
+    };
+
+    struct Stats {
+        int64_t fragments = 0;      // covered pixels that were shaded
+        int64_t clearedPixels = 0;
+        int triangles = 0;
+        int lines = 0;
+        double rasterSeconds = 0.0; // time spent in clears and draws
+    };
+
+private:
+    static const int maxAttributes = 16;
+
+    struct Texture {
+        int width = 0, height = 0;
+        bool linear = false;
+        bool clamp = false;
+        std::vector<uint32_t> texels;   // RGBA8, byte order r, g, b, a
+    };
+
+    struct Attribute {
+        bool enabled = false;
+        unsigned int buffer = 0;
+        int components = 0;
+        size_t stride = 0;
+        size_t offset = 0;
+        GLuint divisor = 0;
+    };
+
+    struct VertexArray {
+        Attribute attributes[maxAttributes];
+        unsigned int elementBuffer = 0;
+    };
+
+    // What the emulated vertex and fragment stages read; -1 when the shader lacks it
+    struct Program {
+        int corner = -1, color = -1;
+        int offset = -1, axes = -1, texRect = -1;
+        int shape[4] = { -1, -1, -1, -1 };
+        GLint samplerUniform = -1, viewProjectionUniform = -1;
+        std::vector<float> uniforms;    // 4 floats per location
+    };
+
+    struct RasterVertex {
+        float x, y;     // pixels, y down
+        float u, v;
+    };
+
+    struct Shading {
+        const Texture* texture;     // null: solid tint
+        float tint[4];
+    };
+
+    static const int maxUnits = 16;
+    static const int subpixelBits = 4;
+
+    int width, height;
+    std::vector<uint32_t> framebuffer;
+    std::vector<uint32_t> spanTexels;
+
+    // Fragments shaded per pixel, discarded ones included; empty while not counting
+    std::vector<uint16_t> overdraw;
+    std::vector<uint16_t> lastOverdraw;
+
+    std::unordered_map<unsigned int, Texture> textures;
+    std::unordered_map<unsigned int, std::vector<unsigned char>> buffers;
+    std::unordered_map<unsigned int, VertexArray> vertexArrays;
+    std::unordered_map<unsigned int, Program> programs;
+    unsigned int streamId;
+
+    unsigned int currentProgram;
+    unsigned int currentVertexArray;
+    unsigned int arrayBuffer;
+    unsigned int activeUnit;
+    unsigned int units[maxUnits];
+    bool blend;
+
+    Stats frameStats;
+    Stats lastFrameStats;
+    Stats totalStats;
+    uint64_t lastChecksum;
+
+    // Timers measure raster time; a result is ready as soon as its timer ends
+    std::unordered_map<unsigned int, uint64_t> timerResults;
+    unsigned int runningTimer;
+    double timerStart;
+
+    // ---- span kernels ------------------------------------------------------------
+
+    // Rounded x / 255 for x <= 255 * 255, exact for every input
+    static uint32_t div255(uint32_t x) {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    static __m128i div255(__m128i x) {
+        x = _mm_add_epi16(x, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    }
+
+#if defined(__AVX2__)
+    static __m256i div255(__m256i x) {
+        x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+    }
+#endif
+
+    static void fillSpan(uint32_t* dst, int count, uint32_t value) {
+        int i = 0;
+#if defined(__AVX2__)
+        __m256i wide = _mm256_set1_epi32(static_cast<int>(value));
+        for (; i + 8 <= count; i += 8) _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), wide);
+#endif
+        __m128i pixels = _mm_set1_epi32(static_cast<int>(value));
+        for (; i + 4 <= count; i += 4) _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), pixels);
+        for (; i < count; ++i) dst[i] = value;
+    }
+
+    // texel * tint with the alpha test: texels below alpha 0.1 (26 of 255) become 0,
+    // which the blend then leaves untouched. tint holds four 0..255 factors.
+    static void modulateSpan(uint32_t* texels, int count, const uint16_t tint[4]) {
+        int i = 0;
+#if defined(__AVX2__)
+        const __m256i tint8 = _mm256_setr_epi16(tint[0], tint[1], tint[2], tint[3], tint[0], tint[1], tint[2], tint[3],
+            tint[0], tint[1], tint[2], tint[3], tint[0], tint[1], tint[2], tint[3]);
+        const __m256i zero8 = _mm256_setzero_si256();
+        const __m256i threshold8 = _mm256_set1_epi32(25);
+        for (; i + 8 <= count; i += 8) {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(texels + i));
+            __m256i keep = _mm256_cmpgt_epi32(_mm256_srli_epi32(pixels, 24), threshold8);
+            __m256i lo = div255(_mm256_mullo_epi16(_mm256_unpacklo_epi8(pixels, zero8), tint8));
+            __m256i hi = div255(_mm256_mullo_epi16(_mm256_unpackhi_epi8(pixels, zero8), tint8));
+            __m256i result = _mm256_and_si256(_mm256_packus_epi16(lo, hi), keep);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(texels + i), result);
+        }
+#endif
+        const __m128i tint4 = _mm_setr_epi16(tint[0], tint[1], tint[2], tint[3], tint[0], tint[1], tint[2], tint[3]);
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i threshold = _mm_set1_epi32(25);
+        for (; i + 4 <= count; i += 4) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels + i));
+            __m128i keep = _mm_cmpgt_epi32(_mm_srli_epi32(pixels, 24), threshold);
+            __m128i lo = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), tint4));
+            __m128i hi = div255(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), tint4));
+            __m128i result = _mm_and_si128(_mm_packus_epi16(lo, hi), keep);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(texels + i), result);
+        }
+        for (; i < count; ++i) {
+            uint32_t pixel = texels[i];
+            if ((pixel >> 24) <= 25) {
+                texels[i] = 0;
+                continue;
+            }
+            uint32_t result = 0;
+            for (int c = 0; c < 4; ++c) {
+                result |= div255(((pixel >> (8 * c)) & 0xFF) * tint[c]) << (8 * c);
+            }
+            texels[i] = result;
+        }
+    }
+
+    // dst = src * src.a + dst * (1 - src.a) on every channel, alpha included, as GL does
+    static void blendSpan(uint32_t* dst, const uint32_t* src, int count) {
+        int i = 0;
+#if defined(__AVX2__)
+        const __m256i zero8 = _mm256_setzero_si256();
+        const __m256i full8 = _mm256_set1_epi16(255);
+        for (; i + 8 <= count; i += 8) {
+            __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+            __m256i sLo = _mm256_unpacklo_epi8(s, zero8), sHi = _mm256_unpackhi_epi8(s, zero8);
+            __m256i dLo = _mm256_unpacklo_epi8(d, zero8), dHi = _mm256_unpackhi_epi8(d, zero8);
+            __m256i aLo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(sLo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            __m256i aHi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(sHi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            __m256i lo = div255(_mm256_add_epi16(_mm256_mullo_epi16(sLo, aLo), _mm256_mullo_epi16(dLo, _mm256_sub_epi16(full8, aLo))));
+            __m256i hi = div255(_mm256_add_epi16(_mm256_mullo_epi16(sHi, aHi), _mm256_mullo_epi16(dHi, _mm256_sub_epi16(full8, aHi))));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+        }
+#endif
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i full = _mm_set1_epi16(255);
+        for (; i + 4 <= count; i += 4) {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            __m128i sLo = _mm_unpacklo_epi8(s, zero), sHi = _mm_unpackhi_epi8(s, zero);
+            __m128i dLo = _mm_unpacklo_epi8(d, zero), dHi = _mm_unpackhi_epi8(d, zero);
+            __m128i aLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sLo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            __m128i aHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sHi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            __m128i lo = div255(_mm_add_epi16(_mm_mullo_epi16(sLo, aLo), _mm_mullo_epi16(dLo, _mm_sub_epi16(full, aLo))));
+            __m128i hi = div255(_mm_add_epi16(_mm_mullo_epi16(sHi, aHi), _mm_mullo_epi16(dHi, _mm_sub_epi16(full, aHi))));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+        }
+        for (; i < count; ++i) {
+            uint32_t s = src[i], d = dst[i];
+            uint32_t a = s >> 24;
+            uint32_t result = 0;
+            for (int c = 0; c < 4; ++c) {
+                uint32_t sc = (s >> (8 * c)) & 0xFF, dc = (d >> (8 * c)) & 0xFF;
+                result |= div255(sc * a + dc * (255 - a)) << (8 * c);
+            }
+            dst[i] = result;
+        }
+    }
+
+    // Without blending a discarded fragment (all zero after modulateSpan) keeps the old pixel
+    static void copySpan(uint32_t* dst, const uint32_t* src, int count) {
+        for (int i = 0; i < count; ++i) {
+            if (src[i]) dst[i] = src[i];
+        }
+    }
+
+    static uint32_t packColor(float r, float g, float b, float a) {
+        auto channel = [](float value) {
+            return static_cast<uint32_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+        };
+        return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (channel(a) << 24);
+    }
+
+    // ---- texture sampling --------------------------------------------------------
+
+    // 1, 3 or 4 channel bytes to packed RGBA; a single channel is red, like GL_RED
+    static void convertTexels(int channels, const unsigned char* pixels, uint32_t* texels, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            const unsigned char* p = pixels + i * channels;
+            uint32_t r = p[0];
+            uint32_t g = channels >= 3 ? p[1] : 0;
+            uint32_t b = channels >= 3 ? p[2] : 0;
+            uint32_t a = channels == 4 ? p[3] : 255;
+            texels[i] = r | (g << 8) | (b << 16) | (a << 24);
+        }
+    }
+
+    static int wrapCoord(int i, int size, bool clamp) {
+        if (clamp) return std::min(std::max(i, 0), size - 1);
+        i %= size;
+        return i < 0 ? i + size : i;
+    }
+
+    static uint32_t sample(const Texture& texture, float u, float v) {
+        if (texture.texels.empty()) return 0;
+        if (!texture.linear) {
+            int x = wrapCoord(static_cast<int>(std::floor(u * texture.width)), texture.width, texture.clamp);
+            int y = wrapCoord(static_cast<int>(std::floor(v * texture.height)), texture.height, texture.clamp);
+            return texture.texels[static_cast<size_t>(y) * texture.width + x];
+        }
+
+        // Bilinear with 8-bit weights
+        float fx = u * texture.width - 0.5f;
+        float fy = v * texture.height - 0.5f;
+        int x0 = static_cast<int>(std::floor(fx));
+        int y0 = static_cast<int>(std::floor(fy));
+        uint32_t wx = static_cast<uint32_t>((fx - x0) * 256.0f);
+        uint32_t wy = static_cast<uint32_t>((fy - y0) * 256.0f);
+        int xa = wrapCoord(x0, texture.width, texture.clamp), xb = wrapCoord(x0 + 1, texture.width, texture.clamp);
+        int ya = wrapCoord(y0, texture.height, texture.clamp), yb = wrapCoord(y0 + 1, texture.height, texture.clamp);
+        const uint32_t* rowA = texture.texels.data() + static_cast<size_t>(ya) * texture.width;
+        const uint32_t* rowB = texture.texels.data() + static_cast<size_t>(yb) * texture.width;
+        uint32_t t00 = rowA[xa], t10 = rowA[xb], t01 = rowB[xa], t11 = rowB[xb];
+
+        uint32_t result = 0;
+        for (int c = 0; c < 4; ++c) {
+            int shift = 8 * c;
+            uint32_t top = ((t00 >> shift) & 0xFF) * (256 - wx) + ((t10 >> shift) & 0xFF) * wx;
+            uint32_t bottom = ((t01 >> shift) & 0xFF) * (256 - wx) + ((t11 >> shift) & 0xFF) * wx;
+            result |= (((top * (256 - wy) + bottom * wy) + 32768) >> 16) << shift;
+        }
+        return result;
+    }
+
+    // ---- rasterization -----------------------------------------------------------
+
+    void shadeSpan(uint32_t* row, int x0, int count, const Shading& shading,
+        float u, float v, float du, float dv) {
+        uint32_t* texels = spanTexels.data();
+        if (shading.texture) {
+            for (int i = 0; i < count; ++i) {
+                texels[i] = sample(*shading.texture, u + du * i, v + dv * i);
+            }
+        }
+        else {
+            fillSpan(texels, count, 0xFFFFFFFFu);
+        }
+
+        uint16_t tint[4];
+        for (int c = 0; c < 4; ++c) {
+            tint[c] = static_cast<uint16_t>(std::lround(std::min(std::max(shading.tint[c], 0.0f), 1.0f) * 255.0f));
+        }
+        modulateSpan(texels, count, tint);
+
+        if (blend) blendSpan(row + x0, texels, count);
+        else copySpan(row + x0, texels, count);
+        frameStats.fragments += count;
+        if (!overdraw.empty()) countFragments(static_cast<size_t>(row - framebuffer.data()) + x0, count);
+    }
+
+    void drawTriangle(RasterVertex a, RasterVertex b, RasterVertex c, const Shading& shading) {
+        const int64_t one = 1 << subpixelBits;
+        auto fixed = [](float value) { return static_cast<int64_t>(std::lround(value * (1 << subpixelBits))); };
+        int64_t ax = fixed(a.x), ay = fixed(a.y);
+        int64_t bx = fixed(b.x), by = fixed(b.y);
+        int64_t cx = fixed(c.x), cy = fixed(c.y);
+
+        int64_t area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+        if (area == 0) return;
+        if (area < 0) {
+            std::swap(b, c);
+            std::swap(bx, cx);
+            std::swap(by, cy);
+            area = -area;
+        }
+        ++frameStats.triangles;
+
+        int minX = static_cast<int>(std::max<int64_t>(0, std::min({ ax, bx, cx }) >> subpixelBits));
+        int maxX = static_cast<int>(std::min<int64_t>(width - 1, std::max({ ax, bx, cx }) >> subpixelBits));
+        int minY = static_cast<int>(std::max<int64_t>(0, std::min({ ay, by, cy }) >> subpixelBits));
+        int maxY = static_cast<int>(std::min<int64_t>(height - 1, std::max({ ay, by, cy }) >> subpixelBits));
+        if (minX > maxX || minY > maxY) return;
+
+        // Edge i is opposite vertex i; E(p) = (end - start) x (p - start), positive inside
+        const int64_t sx[3] = { bx, cx, ax }, sy[3] = { by, cy, ay };
+        const int64_t ex[3] = { cx, ax, bx }, ey[3] = { cy, ay, by };
+        int64_t stepX[3], stepY[3], rowStart[3], bias[3];
+        int64_t px = (static_cast<int64_t>(minX) << subpixelBits) + one / 2;
+        int64_t py = (static_cast<int64_t>(minY) << subpixelBits) + one / 2;
+        for (int i = 0; i < 3; ++i) {
+            int64_t dx = ex[i] - sx[i], dy = ey[i] - sy[i];
+            stepX[i] = -dy * one;
+            stepY[i] = dx * one;
+            rowStart[i] = dx * (py - sy[i]) - dy * (px - sx[i]);
+            // Top-left rule: pixels exactly on an edge belong to one of the two triangles sharing it
+            bias[i] = (dy < 0 || (dy == 0 && dx > 0)) ? 0 : -1;
+        }
+
+        // Texture coordinates are affine in screen space
+        float invArea = 1.0f / static_cast<float>(area);
+        const float us[3] = { a.u, b.u, c.u }, vs[3] = { a.v, b.v, c.v };
+
+        for (int y = minY; y <= maxY; ++y) {
+            int64_t e[3] = { rowStart[0], rowStart[1], rowStart[2] };
+            int first = -1, last = -1;
+            for (int x = minX; x <= maxX; ++x) {
+                bool inside = e[0] + bias[0] >= 0 && e[1] + bias[1] >= 0 && e[2] + bias[2] >= 0;
+                if (inside) {
+                    if (first < 0) first = x;
+                    last = x;
+                }
+                else if (first >= 0) {
+                    break;   // triangles are convex, one span per row
+                }
+                for (int i = 0; i < 3; ++i) e[i] += stepX[i];
+            }
+
+            if (first >= 0) {
+                int64_t offset = first - minX;
+                float w[3], dw[3];
+                for (int i = 0; i < 3; ++i) {
+                    w[i] = static_cast<float>(rowStart[i] + stepX[i] * offset) * invArea;
+                    dw[i] = static_cast<float>(stepX[i]) * invArea;
+                }
+                float u = w[0] * us[0] + w[1] * us[1] + w[2] * us[2];
+                float v = w[0] * vs[0] + w[1] * vs[1] + w[2] * vs[2];
+                float du = dw[0] * us[0] + dw[1] * us[1] + dw[2] * us[2];
+                float dv = dw[0] * vs[0] + dw[1] * vs[1] + dw[2] * vs[2];
+                shadeSpan(framebuffer.data() + static_cast<size_t>(y) * width, first, last - first + 1,
+                    shading, u, v, du, dv);
+            }
+
+            for (int i = 0; i < 3; ++i) rowStart[i] += stepY[i];
+        }
+    }
+
+    void countFragments(size_t first, int count) {
+        uint16_t* layers = overdraw.data() + first;
+        for (int i = 0; i < count; ++i) {
+            if (layers[i] < 0xFFFF) ++layers[i];
+        }
+    }
+
+    // One pixel wide, Bresenham
+    void drawLine(const RasterVertex& a, const RasterVertex& b, const Shading& shading) {
+        ++frameStats.lines;
+        uint32_t color = packColor(shading.tint[0], shading.tint[1], shading.tint[2], shading.tint[3]);
+        int x0 = static_cast<int>(std::floor(a.x)), y0 = static_cast<int>(std::floor(a.y));
+        int x1 = static_cast<int>(std::floor(b.x)), y1 = static_cast<int>(std::floor(b.y));
+        int dx = std::abs(x1 - x0), dy = -std::abs(y1 - y0);
+        int stepX = x0 < x1 ? 1 : -1, stepY = y0 < y1 ? 1 : -1;
+        int error = dx + dy;
+        while (true) {
+            if (x0 >= 0 && x0 < width && y0 >= 0 && y0 < height) {
+                uint32_t* pixel = framebuffer.data() + static_cast<size_t>(y0) * width + x0;
+                if (blend) blendSpan(pixel, &color, 1);
+                else *pixel = color;
+                ++frameStats.fragments;
+                if (!overdraw.empty()) countFragments(static_cast<size_t>(y0) * width + x0, 1);
+            }
+            if (x0 == x1 && y0 == y1) break;
+            int doubled = 2 * error;
+            if (doubled >= dy) { error += dy; x0 += stepX; }
+            if (doubled <= dx) { error += dx; y0 += stepY; }
+        }
+    }
+
+    // ---- emulated shaders --------------------------------------------------------
+
+    // "layout (location = N) in <type> <name>;" declarations of the vertex shader
+    static void scanAttributes(const std::string& source, std::unordered_map<std::string, int>& locations) {
+        std::string spaced = source;
+        for (char& ch : spaced) {
+            if (ch == '(' || ch == ')' || ch == '=' || ch == ';') ch = ' ';
+        }
+        std::istringstream stream(spaced);
+        std::string word;
+        while (stream >> word) {
+            if (word != "layout") continue;
+            std::string qualifier, direction, type, name;
+            int location = -1;
+            if (stream >> qualifier >> location >> direction >> type >> name &&
+                qualifier == "location" && direction == "in") {
+                locations[name] = location;
+            }
+        }
+    }
+
+    Program* program() {
+        auto it = programs.find(currentProgram);
+        return it == programs.end() ? nullptr : &it->second;
+    }
+
+    const float* uniformValue(const Program& prog, GLint location) const {
+        if (location < 0 || static_cast<size_t>(location) * 4 >= prog.uniforms.size()) return nullptr;
+        return prog.uniforms.data() + location * 4;
+    }
+
+    float* uniformSlot(GLint location) {
+        Program* prog = program();
+        if (!prog || location < 0) return nullptr;
+        if (static_cast<size_t>(location) * 4 + 4 > prog->uniforms.size()) prog->uniforms.resize(location * 4 + 4, 0.0f);
+        return prog->uniforms.data() + location * 4;
+    }
+
+    // Reads attribute location of a vertex, (0, 0, 0, 1) when it is disabled
+    void fetch(int location, int vertex, int instance, float out[4]) const {
+        out[0] = out[1] = out[2] = 0.0f;
+        out[3] = 1.0f;
+        if (location < 0 || location >= maxAttributes) return;
+        auto vao = vertexArrays.find(currentVertexArray);
+        if (vao == vertexArrays.end()) return;
+        const Attribute& attribute = vao->second.attributes[location];
+        if (!attribute.enabled) return;
+        auto buffer = buffers.find(attribute.buffer);
+        if (buffer == buffers.end()) return;
+
+        size_t index = attribute.divisor ? instance / attribute.divisor : vertex;
+        size_t stride = attribute.stride ? attribute.stride : attribute.components * sizeof(float);
+        size_t begin = attribute.offset + index * stride;
+        size_t bytes = attribute.components * sizeof(float);
+        if (begin + bytes > buffer->second.size()) return;
+        std::memcpy(out, buffer->second.data() + begin, bytes);
+    }
+
+    // Sprite flags, as the vertex shader reads them from "aOffset".z
+    static const int screenSpaceFlag = 1;
+    static const int untexturedFlag = 2;
+
+    // The vertex stage: position in pixels, texture coordinates, the flat tint and flags
+    RasterVertex transform(const Program& prog, int vertex, int instance, float tint[4], int& flags) const {
+        float value[4], rect[4];
+        fetch(prog.corner, vertex, instance, value);
+        int corner = std::min(std::max(static_cast<int>(value[0]), 0), 7);
+        fetch(prog.shape[corner / 2], vertex, instance, value);
+        float t[2] = { value[(corner & 1) * 2], value[(corner & 1) * 2 + 1] };
+        fetch(prog.texRect, vertex, instance, rect);
+        float x = t[0] - 0.5f, y = 0.5f - t[1];
+
+        flags = 0;
+        if (prog.axes >= 0) {
+            fetch(prog.axes, vertex, instance, value);
+            float px = x, py = y;
+            x = value[0] * px + value[2] * py;
+            y = value[1] * px + value[3] * py;
+        }
+        if (prog.offset >= 0) {
+            fetch(prog.offset, vertex, instance, value);
+            x += value[0];
+            y += value[1];
+            flags = static_cast<int>(value[2]);
+        }
+        const float* view = uniformValue(prog, prog.viewProjectionUniform);
+        if (view && !(flags & screenSpaceFlag)) {
+            x = x * view[0] + view[2];
+            y = y * view[1] + view[3];
+        }
+
+        RasterVertex out;
+        out.x = (x + 1.0f) * 0.5f * width;
+        out.y = (1.0f - y) * 0.5f * height;
+
+        out.u = rect[0] + (rect[2] - rect[0]) * t[0];
+        out.v = rect[1] + (rect[3] - rect[1]) * t[1];
+
+        tint[0] = tint[1] = tint[2] = tint[3] = 1.0f;
+        if (prog.color >= 0) fetch(prog.color, vertex, instance, tint);
+        return out;
+    }
+
+    Shading shadingFor(const Program& prog, const float tint[4], int flags) const {
+        Shading shading;
+        shading.texture = nullptr;
+        std::copy(tint, tint + 4, shading.tint);
+        if (prog.samplerUniform >= 0 && !(flags & untexturedFlag)) {
+            const float* unit = uniformValue(prog, prog.samplerUniform);
+            unsigned int index = unit ? static_cast<unsigned int>(unit[0]) : 0;
+            auto it = index < static_cast<unsigned int>(maxUnits) ? textures.find(units[index]) : textures.end();
+            if (it != textures.end()) shading.texture = &it->second;
+        }
+        return shading;
+    }
+
+    void drawPrimitives(GLenum mode, const unsigned int* indices, int first, int count, int baseVertex, int instance) {
+        Program* prog = program();
+        if (!prog) return;
+        auto vertexIndex = [&](int i) { return (indices ? static_cast<int>(indices[i]) : first + i) + baseVertex; };
+
+        float tint[4], ignored[4];
+        int flags, ignoredFlags;
+        if (mode == GL_TRIANGLES) {
+            for (int i = 0; i + 2 < count; i += 3) {
+                RasterVertex a = transform(*prog, vertexIndex(i), instance, tint, flags);
+                RasterVertex b = transform(*prog, vertexIndex(i + 1), instance, ignored, ignoredFlags);
+                RasterVertex c = transform(*prog, vertexIndex(i + 2), instance, ignored, ignoredFlags);
+                drawTriangle(a, b, c, shadingFor(*prog, tint, flags));
+            }
+        }
+        else if (mode == GL_LINES) {
+            for (int i = 0; i + 1 < count; i += 2) {
+                RasterVertex a = transform(*prog, vertexIndex(i), instance, tint, flags);
+                RasterVertex b = transform(*prog, vertexIndex(i + 1), instance, ignored, ignoredFlags);
+                drawLine(a, b, shadingFor(*prog, tint, flags));
+            }
+        }
+    }
+
+    const unsigned int* boundIndices(int count) const {
+        auto vao = vertexArrays.find(currentVertexArray);
+        if (vao == vertexArrays.end()) return nullptr;
+        auto buffer = buffers.find(vao->second.elementBuffer);
+        if (buffer == buffers.end() || buffer->second.size() < count * sizeof(unsigned int)) return nullptr;
+        return reinterpret_cast<const unsigned int*>(buffer->second.data());
+    }
+
+    class Timer {
+    private:
+        double& total;
+        std::chrono::steady_clock::time_point start;
+    public:
+        explicit Timer(double& total) : total(total), start(std::chrono::steady_clock::now()) {}
+        ~Timer() { total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+    };
+
+public:
+    SoftwareBackend(int width = 1920, int height = 1080)
+        : width(0), height(0), currentProgram(0), currentVertexArray(0), arrayBuffer(0), activeUnit(0),
+        blend(false), lastChecksum(0), runningTimer(0), timerStart(0.0)
+    {
+        streamId = nextId++;
+        buffers[streamId];
+        for (int i = 0; i < maxUnits; ++i) units[i] = 0;
+        setViewport(0, 0, width, height);
+    }
+
+    const char* getName() const override { return "software"; }
+
+    // Resources
+
+    unsigned int createTexture(const TextureDesc& desc, const unsigned char* pixels) override {
+        unsigned int id = nextId++;
+        Texture& texture = textures[id];
+        texture.width = desc.width;
+        texture.height = desc.height;
+        texture.linear = desc.filter == TextureFilter::Linear;
+        texture.clamp = desc.clampToEdge;
+        texture.texels.resize(static_cast<size_t>(desc.width) * desc.height);
+        if (pixels) convertTexels(desc.channels, pixels, texture.texels.data(), texture.texels.size());
+        return id;
+    }
+
+    void updateTextureRows(unsigned int id, const TextureDesc& desc, int y, int rows, const unsigned char* pixels) override {
+        auto it = textures.find(id);
+        if (it == textures.end()) return;
+        size_t first = static_cast<size_t>(y) * desc.width;
+        convertTexels(desc.channels, pixels, it->second.texels.data() + first, static_cast<size_t>(rows) * desc.width);
+    }
+
+    // Sampled like the GPU would: the decoded blocks of level 0
+    unsigned int createCompressedTexture(const TextureDesc& desc, const CompressedImage& image) override {
+        TextureDesc expanded = desc;
+        std::vector<unsigned char> pixels = TextureCompressor::decompress(image, 0, expanded.width, expanded.height);
+        expanded.channels = 4;
+        return createTexture(expanded, pixels.data());
+    }
+
+    bool supportsCompressedFormat(CompressedFormat) const override { return true; }
+
+    void deleteTexture(unsigned int id) override { textures.erase(id); }
+
+    unsigned int createBuffer() override {
+        unsigned int id = nextId++;
+        buffers[id];
+        return id;
+    }
+
+    void bufferData(GLenum target, size_t bytes, const void* data, GLenum) override {
+        unsigned int id = arrayBuffer;
+        if (target == GL_ELEMENT_ARRAY_BUFFER) {
+            auto vao = vertexArrays.find(currentVertexArray);
+            id = vao == vertexArrays.end() ? 0 : vao->second.elementBuffer;
+        }
+        auto it = buffers.find(id);
+        if (it == buffers.end()) return;
+        it->second.assign(bytes, 0);
+        if (data) std::memcpy(it->second.data(), data, bytes);
+    }
+
+    void deleteBuffer(unsigned int id) override { buffers.erase(id); }
+
+    unsigned int createVertexArray() override {
+        unsigned int id = nextId++;
+        vertexArrays[id];
+        return id;
+    }
+
+    void deleteVertexArray(unsigned int id) override { vertexArrays.erase(id); }
+
+    void vertexAttribute(GLuint location, int components, size_t stride, size_t offset, GLuint divisor) override {
+        auto vao = vertexArrays.find(currentVertexArray);
+        if (vao == vertexArrays.end() || location >= static_cast<GLuint>(maxAttributes)) return;
+        Attribute& attribute = vao->second.attributes[location];
+        attribute.enabled = true;
+        attribute.buffer = arrayBuffer;
+        attribute.components = components;
+        attribute.stride = stride;
+        attribute.offset = offset;
+        attribute.divisor = divisor;
+    }
+
+    unsigned int createProgram(const std::string& vertexSource, const std::string& fragmentSource,
+        std::vector<UniformDesc>& uniforms) override {
+        unsigned int id = NullBackend::createProgram(vertexSource, fragmentSource, uniforms);
+
+        std::unordered_map<std::string, int> attributes;
+        scanAttributes(vertexSource, attributes);
+        auto attribute = [&](const char* name) {
+            auto it = attributes.find(name);
+            return it == attributes.end() ? -1 : it->second;
+        };
+        auto uniform = [&](const char* name) {
+            for (const UniformDesc& desc : uniforms) {
+                if (desc.name == name) return desc.location;
+            }
+            return -1;
+        };
+
+        Program& prog = programs[id];
+        prog.corner = attribute("aCorner");
+        prog.color = attribute("aColor");
+        prog.offset = attribute("aOffset");
+        prog.axes = attribute("aAxes");
+        prog.texRect = attribute("aTexRect");
+        prog.shape[0] = attribute("aShape01");
+        prog.shape[1] = attribute("aShape23");
+        prog.shape[2] = attribute("aShape45");
+        prog.shape[3] = attribute("aShape67");
+        prog.samplerUniform = uniform("ourTexture1");
+        prog.viewProjectionUniform = uniform("viewProjection");
+        prog.uniforms.assign(uniforms.size() * 4, 0.0f);
+        if (prog.corner < 0 || prog.shape[0] < 0) {
+            std::cerr << "Software backend: program " << id << " has no position attribute it understands" << std::endl;
+        }
+        return id;
+    }
+
+    void deleteProgram(unsigned int id) override { programs.erase(id); }
+
+    unsigned int createTimer() override { return nextId++; }
+    void deleteTimer(unsigned int id) override { timerResults.erase(id); }
+
+    void beginTimer(unsigned int id) override {
+        runningTimer = id;
+        timerStart = frameStats.rasterSeconds;
+    }
+
+    void endTimer() override {
+        if (!runningTimer) return;
+        timerResults[runningTimer] = static_cast<uint64_t>((frameStats.rasterSeconds - timerStart) * 1e9);
+        runningTimer = 0;
+    }
+
+    bool timerResult(unsigned int id, uint64_t& nanoseconds) override {
+        auto it = timerResults.find(id);
+        if (it == timerResults.end()) return false;
+        nanoseconds = it->second;
+        timerResults.erase(it);
+        return true;
+    }
+
+    size_t streamUpload(const void* data, size_t bytes, size_t alignment) override {
+        size_t offset = NullBackend::streamUpload(data, bytes, alignment);
+        if (offset == streamUploadFailed) return offset;
+        std::vector<unsigned char>& stream = buffers[streamId];
+        if (stream.size() < offset + bytes) stream.resize(std::max(offset + bytes, stream.size() * 2));
+        std::memcpy(stream.data() + offset, data, bytes);
+        return offset;
+    }
+
+    unsigned int streamBuffer() override { return streamId; }
+
+    // State
+
+    void useProgram(unsigned int id) override { currentProgram = id; }
+    void bindVertexArray(unsigned int id) override { currentVertexArray = id; }
+
+    void bindBuffer(GLenum target, unsigned int id) override {
+        if (target == GL_ARRAY_BUFFER) {
+            arrayBuffer = id;
+        }
+        else if (target == GL_ELEMENT_ARRAY_BUFFER) {
+            auto vao = vertexArrays.find(currentVertexArray);
+            if (vao != vertexArrays.end()) vao->second.elementBuffer = id;
+        }
+    }
+
+    void activeTexture(unsigned int unit) override { activeUnit = unit; }
+
+    void bindTexture(unsigned int id) override {
+        if (activeUnit < static_cast<unsigned int>(maxUnits)) units[activeUnit] = id;
+    }
+
+    void setBlend(bool enabled) override { blend = enabled; }
+
+    // Only SRC_ALPHA, ONE_MINUS_SRC_ALPHA is implemented, the one function the game uses
+    void blendFunc(GLenum, GLenum) override {}
+
+    void setUniform(GLint location, int value) override {
+        if (float* slot = uniformSlot(location)) slot[0] = static_cast<float>(value);
+    }
+    void setUniform(GLint location, float value) override {
+        if (float* slot = uniformSlot(location)) slot[0] = value;
+    }
+    void setUniform(GLint location, float x, float y) override {
+        if (float* slot = uniformSlot(location)) { slot[0] = x; slot[1] = y; }
+    }
+    void setUniform(GLint location, float x, float y, float z) override {
+        if (float* slot = uniformSlot(location)) { slot[0] = x; slot[1] = y; slot[2] = z; }
+    }
+    void setUniform(GLint location, float x, float y, float z, float w) override {
+        if (float* slot = uniformSlot(location)) { slot[0] = x; slot[1] = y; slot[2] = z; slot[3] = w; }
+    }
+
+    // Drawing
+
+    // The framebuffer is always as big as the viewport
+    void setViewport(int, int, int w, int h) override {
+        if (w <= 0 || h <= 0 || (w == width && h == height)) return;
+        width = w;
+        height = h;
+        framebuffer.assign(static_cast<size_t>(w) * h, 0);
+        spanTexels.resize(w);
+        if (!overdraw.empty()) setOverdrawCounting(true);
+    }
+
+    void clear(float r, float g, float b) override {
+        Timer timer(frameStats.rasterSeconds);
+        fillSpan(framebuffer.data(), static_cast<int>(framebuffer.size()), packColor(r, g, b, 1.0f));
+        frameStats.clearedPixels += framebuffer.size();
+    }
+
+    void drawIndexed(GLenum mode, int indexCount, int baseVertex) override {
+        Timer timer(frameStats.rasterSeconds);
+        const unsigned int* indices = boundIndices(indexCount);
+        if (indices) drawPrimitives(mode, indices, 0, indexCount, baseVertex, 0);
+    }
+
+    void drawIndexedInstanced(GLenum mode, int indexCount, int instanceCount) override {
+        Timer timer(frameStats.rasterSeconds);
+        const unsigned int* indices = boundIndices(indexCount);
+        if (!indices) return;
+        for (int instance = 0; instance < instanceCount; ++instance) {
+            drawPrimitives(mode, indices, 0, indexCount, 0, instance);
+        }
+    }
+
+    void drawArrays(GLenum mode, int first, int count) override {
+        Timer timer(frameStats.rasterSeconds);
+        drawPrimitives(mode, nullptr, first, count, 0, 0);
+    }
+
+    // Frame capture
+
+    void endFrame() override {
+        NullBackend::endFrame();
+
+        // FNV-1a over the framebuffer bytes
+        uint64_t hash = 14695981039346656037ull;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(framebuffer.data());
+        for (size_t i = 0; i < framebuffer.size() * 4; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        lastChecksum = hash;
+
+        if (!overdraw.empty()) {
+            lastOverdraw.swap(overdraw);
+            overdraw.assign(framebuffer.size(), 0);
+        }
+
+        lastFrameStats = frameStats;
+        totalStats.fragments += frameStats.fragments;
+        totalStats.clearedPixels += frameStats.clearedPixels;
+        totalStats.triangles += frameStats.triangles;
+        totalStats.lines += frameStats.lines;
+        totalStats.rasterSeconds += frameStats.rasterSeconds;
+        frameStats = Stats();
+    }
+
+    uint64_t getLastFrameChecksum() const { return lastChecksum; }
+    const Stats& getLastFrameStats() const { return lastFrameStats; }
+    const Stats& getTotalStats() const { return totalStats; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const uint32_t* getPixels() const { return framebuffer.data(); }
+
+    // Counts the fragments every pixel gets from the next frame on: what a fill-rate bound
+    // GPU pays for, including the transparent texels the shader discards
+    void setOverdrawCounting(bool enabled) {
+        overdraw.assign(enabled ? framebuffer.size() : 0, 0);
+        lastOverdraw.assign(enabled ? framebuffer.size() : 0, 0);
+    }
+
+    Overdraw getLastFrameOverdraw() const {
+        Overdraw result;
+        for (uint16_t layers : lastOverdraw) {
+            result.fragments += layers;
+            if (layers) ++result.coveredPixels;
+            result.maxLayers = std::max(result.maxLayers, static_cast<int>(layers));
+        }
+        return result;
+    }
+
+    // The last frame's counts as a heatmap: black never shaded, then blue, cyan, green,
+    // yellow, orange and red for 1 to 7 fragments, white for 8 and more
+    bool writeOverdrawPPM(const std::string& path, int downscale = 1) const {
+        static const uint32_t ramp[9] = {
+            0x000000, 0xA00000, 0xFF8000, 0x64C800, 0x00DC78, 0x00DCFF, 0x0080FF, 0x0000FF, 0xFFFFFF
+        };
+        if (lastOverdraw.empty()) {
+            std::cerr << "Software backend: overdraw is not being counted" << std::endl;
+            return false;
+        }
+        std::vector<uint32_t> heat(lastOverdraw.size());
+        for (size_t i = 0; i < heat.size(); ++i) heat[i] = ramp[std::min<int>(lastOverdraw[i], 8)];
+        return writeImage(path, heat.data(), downscale);
+    }
+
+    // Writes the framebuffer as a binary PPM, box-filtered down by 'downscale' for thumbnails
+    bool writePPM(const std::string& path, int downscale = 1) const {
+        return writeImage(path, framebuffer.data(), downscale);
+    }
+
+private:
+    bool writeImage(const std::string& path, const uint32_t* pixels, int downscale) const {
+        downscale = std::max(downscale, 1);
+        int outWidth = width / downscale, outHeight = height / downscale;
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Could not write " << path << std::endl;
+            return false;
+        }
+        std::fprintf(file, "P6\n%d %d\n255\n", outWidth, outHeight);
+
+        std::vector<unsigned char> row(static_cast<size_t>(outWidth) * 3);
+        int samples = downscale * downscale;
+        for (int y = 0; y < outHeight; ++y) {
+            for (int x = 0; x < outWidth; ++x) {
+                uint32_t sum[3] = { 0, 0, 0 };
+                for (int sy = 0; sy < downscale; ++sy) {
+                    const uint32_t* src = pixels + static_cast<size_t>(y * downscale + sy) * width + x * downscale;
+                    for (int sx = 0; sx < downscale; ++sx) {
+                        for (int c = 0; c < 3; ++c) sum[c] += (src[sx] >> (8 * c)) & 0xFF;
+                    }
+                }
+                for (int c = 0; c < 3; ++c) row[x * 3 + c] = static_cast<unsigned char>((sum[c] + samples / 2) / samples);
+            }
+            std::fwrite(row.data(), 1, row.size(), file);
+        }
+        std::fclose(file);
+        return true;
+    }
+
+public:
+    void printStats() const override {
+        double pixels = static_cast<double>(lastFrameStats.fragments + lastFrameStats.clearedPixels);
+        std::cout << "Software frame: " << lastFrameStats.triangles << " triangles, "
+            << lastFrameStats.fragments << " fragments, " << lastFrameStats.rasterSeconds * 1000.0 << " ms";
+        if (lastFrameStats.rasterSeconds > 0.0) {
+            std::cout << " (" << pixels / lastFrameStats.rasterSeconds / 1e6 << " Mpix/s)";
+        }
+        std::cout << ", checksum " << std::hex << lastChecksum << std::dec << std::endl;
+    }
+};
+
+#endif // SOFTWARE_BACKEND_H
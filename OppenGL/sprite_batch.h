@@ -0,0 +1,218 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "shader.h"
+#include "quad_mesh.h"
+#include "render_backend.h"
+#include "render_stats.h"
+#include "sprite_shape.h"
+
+struct Vec4 {
+    float x, y, z, w;
+    Vec4(float x = 0.0f, float y = 0.0f, float z = 0.0f, float w = 0.0f) : x(x), y(y), z(z), w(w) {}
+};
+
+// Per-sprite switches read by the sprite shader
+struct SpriteFlag {
+    static const uint32_t ScreenSpace = 1;   // position is already in clip space, the camera is not applied
+    static const uint32_t Untextured = 2;    // solid tint, no texel is fetched
+};
+
+// One textured quad submitted to the batch.
+// texCoords: x/z are the u of the left/right edge, y/w are the v of the top/bottom edge,
+// the same layout the old per-object "texCoords" uniform used.
+struct Sprite {
+    float x, y;            // centre of the quad
+    float width, height;
+    Vec4 texCoords;
+    float rotation;        // radians, counter-clockwise around the centre
+    float r, g, b, a;      // tint, multiplied with the texel
+    uint32_t flags;        // SpriteFlag bits
+    uint32_t shape;        // SpriteShapes index of the frame's outline; only valid with the whole frame in texCoords
+
+    Sprite(float x, float y, float width, float height, const Vec4& texCoords,
+        float rotation = 0.0f, float alpha = 1.0f, uint32_t shape = 0)
+        : x(x), y(y), width(width), height(height), texCoords(texCoords),
+        rotation(rotation), r(1.0f), g(1.0f), b(1.0f), a(alpha), flags(0), shape(shape) {}
+};
+
+// What the sprite shader reads per instance (aOffset, aAxes, aTexRect, aColor, aShape01..67),
+// 128 bytes: outline corner t (0..1, y down) lands at offset + (axisX, axisY) * (t.x - 0.5, 0.5 - t.y).
+struct SpriteInstance {
+    float offsetX, offsetY, flags, unused;
+    float axisX[2], axisY[2];   // rotation/scale matrix columns
+    Vec4 texRect;
+    float r, g, b, a;
+    float shape[16];            // SpriteShape corners, mirrored like texRect
+
+    SpriteInstance() = default;
+
+    explicit SpriteInstance(const Sprite& sprite)
+        : offsetX(sprite.x), offsetY(sprite.y), flags(static_cast<float>(sprite.flags)), unused(0.0f),
+        texRect(sprite.texCoords), r(sprite.r), g(sprite.g), b(sprite.b), a(sprite.a) {
+        const Vec4& uv = sprite.texCoords;
+        SpriteShapes::getInstance().get(sprite.shape).orient(uv.z < uv.x, uv.w < uv.y, shape);
+        float c = 1.0f, s = 0.0f;
+        if (sprite.rotation != 0.0f) {
+            c = std::cos(sprite.rotation);
+            s = std::sin(sprite.rotation);
+        }
+        axisX[0] = c * sprite.width;
+        axisX[1] = s * sprite.width;
+        axisY[0] = -s * sprite.height;
+        axisY[1] = c * sprite.height;
+    }
+};
+
+// The one program every sprite path draws with: the batch, level chunks, particles,
+// bullet traces and the crosshair. It instances the shared outline mesh, each sprite
+// trimmed to the outline of its frame, so a frame binds a single program however many
+// kinds of sprites it shows and transparent margins cost no fill rate.
+// Like QuadMesh it lives as long as the GL context.
+class SpriteRenderer {
+private:
+    Shader shader;
+    unsigned int VAO;   // outline mesh, instance attributes into the stream buffer
+    bool overdraw;
+
+    SpriteRenderer() : shader(SpriteProgram::vertexPath, SpriteProgram::fragmentPath), overdraw(false) {
+        shader.Use();
+        shader.uniform<SpriteProgram::Uniform::ourTexture1>().set(0);
+        shader.uniform<SpriteProgram::Uniform::overdraw>().set(0);
+        VAO = RenderBackend::get().createVertexArray();
+        GLState::getInstance().bindVertexArray(VAO);
+        QuadMesh::getInstance().attachOutline(SpriteProgram::aCorner);
+    }
+
+public:
+    static SpriteRenderer& getInstance() {
+        static SpriteRenderer instance;
+        return instance;
+    }
+
+    SpriteRenderer(const SpriteRenderer&) = delete;
+    SpriteRenderer& operator=(const SpriteRenderer&) = delete;
+
+    GLuint program() const { return shader.Program; }
+
+    // Points the instance attributes of the bound VAO at SpriteInstances that start
+    // at offset in the bound GL_ARRAY_BUFFER
+    static void attachInstances(size_t offset) {
+        RenderBackend& backend = RenderBackend::get();
+        const size_t stride = sizeof(SpriteInstance);
+        backend.vertexAttribute(SpriteProgram::aOffset, 4, stride, offset, 1);
+        backend.vertexAttribute(SpriteProgram::aAxes, 4, stride, offset + 4 * sizeof(float), 1);
+        backend.vertexAttribute(SpriteProgram::aTexRect, 4, stride, offset + 8 * sizeof(float), 1);
+        backend.vertexAttribute(SpriteProgram::aColor, 4, stride, offset + 12 * sizeof(float), 1);
+        backend.vertexAttribute(SpriteProgram::aShape01, 4, stride, offset + 16 * sizeof(float), 1);
+        backend.vertexAttribute(SpriteProgram::aShape23, 4, stride, offset + 20 * sizeof(float), 1);
+        backend.vertexAttribute(SpriteProgram::aShape45, 4, stride, offset + 24 * sizeof(float), 1);
+        backend.vertexAttribute(SpriteProgram::aShape67, 4, stride, offset + 28 * sizeof(float), 1);
+    }
+
+    // Fill-rate view: every fragment the sprites shade, discarded ones included, adds the
+    // same step with additive blending, so the brighter a pixel the more often it was shaded
+    void setOverdraw(bool enabled) {
+        overdraw = enabled;
+        shader.Use();
+        shader.uniform<SpriteProgram::Uniform::overdraw>().set(enabled ? 1 : 0);
+    }
+
+    bool isOverdraw() const { return overdraw; }
+
+    // Program, texture and blending for the draws that follow
+    void bind(unsigned int texture) {
+        GLState& gl = GLState::getInstance();
+        gl.setBlend(true);
+        if (overdraw) gl.blendFunc(GL_ONE, GL_ONE);
+        else gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        shader.Use();
+        gl.bindTexture(0, texture);
+    }
+
+    // Most instances one streamUpload can take
+    static const size_t maxInstancesPerDraw = RenderBackend::maxStreamUpload / sizeof(SpriteInstance);
+
+    // Streams count instances and draws them with one instanced call per maxInstancesPerDraw
+    void draw(unsigned int texture, const SpriteInstance* instances, size_t count) {
+        if (count == 0) return;
+        RenderBackend& backend = RenderBackend::get();
+        bind(texture);
+        GLState& gl = GLState::getInstance();
+        gl.bindVertexArray(VAO);
+
+        for (size_t first = 0; first < count; first += maxInstancesPerDraw) {
+            size_t chunk = std::min(count - first, static_cast<size_t>(maxInstancesPerDraw));
+            size_t bytes = chunk * sizeof(SpriteInstance);
+            size_t offset = backend.streamUpload(instances + first, bytes, 16);
+            if (offset == RenderBackend::streamUploadFailed) return;
+            RenderStats::getInstance().recordUpload(bytes);
+
+            gl.bindBuffer(GL_ARRAY_BUFFER, backend.streamBuffer());
+            attachInstances(offset);
+
+            backend.drawIndexedInstanced(GL_TRIANGLES, QuadMesh::outlineIndexCount, static_cast<int>(chunk));
+            RenderStats::getInstance().recordDraw(GL_TRIANGLES, QuadMesh::outlineIndexCount, static_cast<int>(chunk));
+        }
+    }
+};
+
+// Collects the sprites of a frame and issues a single instanced draw
+// for every run of sprites that share a texture.
+class SpriteBatch {
+private:
+    static const int maxSprites = 2048;
+
+    std::vector<SpriteInstance> instances;
+    unsigned int currentTexture;
+
+    int drawCalls;
+    int spriteCount;
+
+public:
+    // SpriteRenderer is created on the first flush, after the loader had the chance to preload its program
+    SpriteBatch() : currentTexture(0), drawCalls(0), spriteCount(0) {
+        instances.reserve(maxSprites);
+    }
+
+    void begin() {
+        drawCalls = 0;
+        spriteCount = 0;
+        GLState::getInstance().setBlend(true);
+        GLState::getInstance().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    void draw(unsigned int texture, const Sprite& sprite) {
+        if (texture != currentTexture || instances.size() >= maxSprites) {
+            flush();
+            currentTexture = texture;
+        }
+        instances.emplace_back(sprite);
+        ++spriteCount;
+    }
+
+    // Sends the sprites collected so far; called on texture changes, a full batch and end()
+    void flush() {
+        if (instances.empty()) return;
+        SpriteRenderer::getInstance().draw(currentTexture, instances.data(), instances.size());
+        instances.clear();
+        ++drawCalls;
+    }
+
+    void end() {
+        flush();
+        GLState::getInstance().setBlend(false);
+    }
+
+    int getDrawCalls() const { return drawCalls; }
+    int getSpriteCount() const { return spriteCount; }
+};
+
+#endif // SPRITE_BATCH_H
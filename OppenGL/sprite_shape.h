@@ -0,0 +1,160 @@
+#ifndef SPRITE_SHAPE_H
+#define SPRITE_SHAPE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Where the visible texels of a frame are, as the eight extents of an 8-DOP in texels:
+// the frame's rectangle with its corners cut at 45 degrees. Computed from the alpha channel
+// when the atlas is packed or cooked; every texel the sprite shader would keep lies inside.
+// Sum and diff bound x + y and x - y, y counting texel rows from the frame's first row.
+struct ShapeBounds {
+    int minX = 0, maxX = 0, minY = 0, maxY = 0;
+    int minSum = 0, maxSum = 0, minDiff = 0, maxDiff = 0;
+
+    static ShapeBounds full(int width, int height) {
+        ShapeBounds bounds;
+        bounds.maxX = width;
+        bounds.maxY = height;
+        bounds.maxSum = width + height;
+        bounds.minDiff = -height;
+        bounds.maxDiff = width;
+        return bounds;
+    }
+
+    bool isFull(int width, int height) const {
+        const ShapeBounds whole = full(width, height);
+        return minX == whole.minX && maxX == whole.maxX && minY == whole.minY && maxY == whole.maxY &&
+            minSum == whole.minSum && maxSum == whole.maxSum && minDiff == whole.minDiff && maxDiff == whole.maxDiff;
+    }
+
+    // pixels: RGBA8 rows 'stride' bytes apart. Texels at or below alpha 25 are the ones the
+    // sprite shader discards (alpha < 0.1). Each kept texel is grown by one texel on every
+    // side, the reach of bilinear filtering. A frame with nothing visible gets empty bounds.
+    static ShapeBounds fromAlpha(const unsigned char* pixels, size_t stride, int width, int height) {
+        const int margin = 1;
+        ShapeBounds bounds;
+        bool any = false;
+        for (int y = 0; y < height; ++y) {
+            const unsigned char* row = pixels + y * stride;
+            int first = -1, last = -1;
+            for (int x = 0; x < width; ++x) {
+                if (row[x * 4 + 3] > 25) {
+                    if (first < 0) first = x;
+                    last = x;
+                }
+            }
+            if (first < 0) continue;
+
+            // The grown texels of this row span one rectangle; the extents are at its corners
+            int left = std::max(first - margin, 0), right = std::min(last + 1 + margin, width);
+            int top = std::max(y - margin, 0), bottom = std::min(y + 1 + margin, height);
+            if (!any) {
+                bounds.minX = left;
+                bounds.maxX = right;
+                bounds.minY = top;
+                bounds.maxY = bottom;
+                bounds.minSum = left + top;
+                bounds.maxSum = right + bottom;
+                bounds.minDiff = left - bottom;
+                bounds.maxDiff = right - top;
+                any = true;
+                continue;
+            }
+            bounds.minX = std::min(bounds.minX, left);
+            bounds.maxX = std::max(bounds.maxX, right);
+            bounds.minY = std::min(bounds.minY, top);
+            bounds.maxY = std::max(bounds.maxY, bottom);
+            bounds.minSum = std::min(bounds.minSum, left + top);
+            bounds.maxSum = std::max(bounds.maxSum, right + bottom);
+            bounds.minDiff = std::min(bounds.minDiff, left - bottom);
+            bounds.maxDiff = std::max(bounds.maxDiff, right - top);
+        }
+        return bounds;
+    }
+};
+
+// The outline a sprite instance is drawn with: 8 corners (x, y) in order around it, in the
+// frame's texture space, 0..1 from its first texel column and row. Cuts that did not remove
+// anything leave two corners on the same spot, so the whole frame is its four corners
+// with every second one repeated.
+struct SpriteShape {
+    float corners[16];
+
+    SpriteShape() : SpriteShape(ShapeBounds::full(1, 1), 1, 1) {}
+
+    SpriteShape(const ShapeBounds& b, int width, int height) {
+        const int points[16] = {
+            b.minSum - b.minY, b.minY,      // top edge, from the top-left cut
+            b.maxDiff + b.minY, b.minY,     // to the top-right cut
+            b.maxX, b.maxX - b.maxDiff,     // right edge
+            b.maxX, b.maxSum - b.maxX,
+            b.maxSum - b.maxY, b.maxY,      // bottom edge
+            b.minDiff + b.maxY, b.maxY,
+            b.minX, b.minX - b.minDiff,     // left edge
+            b.minX, b.minSum - b.minX
+        };
+        for (int i = 0; i < 16; i += 2) {
+            corners[i] = static_cast<float>(points[i]) / width;
+            corners[i + 1] = static_cast<float>(points[i + 1]) / height;
+        }
+    }
+
+    // The corners as a sprite showing the frame mirrored draws them: still clockwise from
+    // the left end of the top edge, so a whole frame keeps the vertex order of an unmirrored one
+    void orient(bool mirrorX, bool mirrorY, float out[16]) const {
+        const int first = mirrorX ? (mirrorY ? 4 : 1) : (mirrorY ? 5 : 0);
+        const int step = mirrorX == mirrorY ? 1 : -1;
+        for (int i = 0; i < 8; ++i) {
+            int from = ((first + step * i) % 8 + 8) % 8;
+            out[2 * i] = mirrorX ? 1.0f - corners[2 * from] : corners[2 * from];
+            out[2 * i + 1] = mirrorY ? 1.0f - corners[2 * from + 1] : corners[2 * from + 1];
+        }
+    }
+
+    // Fraction of the frame's rectangle the outline covers
+    float area() const {
+        float twice = 0.0f;
+        for (int i = 0; i < 8; ++i) {
+            int j = (i + 1) % 8;
+            twice += corners[2 * i] * corners[2 * j + 1] - corners[2 * j] * corners[2 * i + 1];
+        }
+        return std::abs(twice) * 0.5f;
+    }
+};
+
+// Every outline the atlas made, referenced from sprites by index; 0 is the whole frame,
+// for frames without one (standalone textures, parts of a frame, untextured sprites).
+// Filled while the atlas is built, before anything draws, and only read afterwards.
+class SpriteShapes {
+private:
+    std::vector<SpriteShape> shapes;
+
+    SpriteShapes() : shapes(1) {}
+
+public:
+    static SpriteShapes& getInstance() {
+        static SpriteShapes instance;
+        return instance;
+    }
+
+    SpriteShapes(const SpriteShapes&) = delete;
+    SpriteShapes& operator=(const SpriteShapes&) = delete;
+
+    // Index of the outline for bounds of a width x height frame
+    uint32_t add(const ShapeBounds& bounds, int width, int height) {
+        if (bounds.isFull(width, height)) return 0;
+        shapes.emplace_back(bounds, width, height);
+        return static_cast<uint32_t>(shapes.size() - 1);
+    }
+
+    const SpriteShape& get(uint32_t index) const {
+        return index < shapes.size() ? shapes[index] : shapes[0];
+    }
+
+    size_t size() const { return shapes.size(); }
+};
+
+#endif // SPRITE_SHAPE_H
@@ -0,0 +1,86 @@
+#ifndef STATS_OVERLAY_H
+#define STATS_OVERLAY_H
+
+#include <algorithm>
+#include <vector>
+
+#include "render_stats.h"
+#include "sprite_batch.h"
+
+// Graph of RenderStats' pass times in the top-left corner: one column per frame of the
+// history, stacked by pass, with a line at the 60 Hz budget. Drawn by the render thread
+// after the frame's queue, so it is not part of any pass; toggled with F2.
+class StatsOverlay {
+private:
+    static constexpr float left = -0.98f;
+    static constexpr float bottom = 0.5f;
+    static constexpr float graphWidth = 0.6f;
+    static constexpr float budgetHeight = 0.2f;           // clip units for budgetMilliseconds
+    static constexpr float budgetMilliseconds = 1000.0f / 60.0f;
+
+    bool enabled;
+
+    StatsOverlay() : enabled(false) {}
+
+    static Sprite bar(float x, float y, float width, float height, float r, float g, float b, float a) {
+        Sprite sprite(x + 0.5f * width, y + 0.5f * height, width, height, Vec4());
+        sprite.r = r;
+        sprite.g = g;
+        sprite.b = b;
+        sprite.a = a;
+        sprite.flags = SpriteFlag::ScreenSpace | SpriteFlag::Untextured;
+        return sprite;
+    }
+
+public:
+    static StatsOverlay& getInstance() {
+        static StatsOverlay instance;
+        return instance;
+    }
+
+    StatsOverlay(const StatsOverlay&) = delete;
+    StatsOverlay& operator=(const StatsOverlay&) = delete;
+
+    // Render thread only, like the stats it shows
+    void setEnabled(bool on) { enabled = on; }
+    void toggle() { enabled = !enabled; }
+    bool isEnabled() const { return enabled; }
+
+    void draw(SpriteBatch& batch) const {
+        const RenderStats& stats = RenderStats::getInstance();
+        if (!enabled || !stats.hasTimers()) return;
+
+        static const float colors[RenderStats::passCount][3] = {
+            { 0.3f, 0.6f, 1.0f },   // level
+            { 0.3f, 0.9f, 0.3f },   // entities
+            { 1.0f, 0.8f, 0.2f },   // decals
+            { 1.0f, 0.4f, 0.2f },   // particles
+            { 0.9f, 0.3f, 0.9f }    // crosshair
+        };
+        const float scale = budgetHeight / budgetMilliseconds;
+        const float maxHeight = 2.0f * budgetHeight;
+        const float column = graphWidth / RenderStats::historyLength;
+
+        batch.begin();
+        batch.draw(0, bar(left, bottom, graphWidth, maxHeight, 0.0f, 0.0f, 0.0f, 0.5f));
+
+        std::vector<RenderStats::PassTimes> history = stats.getHistory();
+        float x = left + graphWidth - column * history.size();
+        for (const RenderStats::PassTimes& times : history) {
+            float y = 0.0f;
+            for (int pass = 0; pass < RenderStats::passCount && y < maxHeight; ++pass) {
+                if (times.milliseconds[pass] <= 0.0f) continue;
+                float height = std::min(times.milliseconds[pass] * scale, maxHeight - y);
+                const float* c = colors[pass];
+                batch.draw(0, bar(x, bottom + y, column, height, c[0], c[1], c[2], 0.9f));
+                y += height;
+            }
+            x += column;
+        }
+
+        batch.draw(0, bar(left, bottom + budgetHeight, graphWidth, 0.004f, 1.0f, 1.0f, 1.0f, 0.8f));
+        batch.end();
+    }
+};
+
+#endif // STATS_OVERLAY_H
@@ -0,0 +1,199 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cstring>
+#include <deque>
+#include <iostream>
+
+#include "gl_state.h"
+
+// Ring of vertex memory for everything that is rebuilt every frame (sprite batch
+// vertices, particle and bullet trace instances). upload() copies into the next free
+// range and returns its byte offset; draws point their attributes at that offset.
+//
+// Two paths:
+//  - Persistent: with GL 4.4 or ARB_buffer_storage the whole ring is mapped once with
+//    GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT. Every frame's range is fenced and a range
+//    is only rewritten after its fence has signalled.
+//  - Orphan: on plain GL 3.3 each upload maps its range unsynchronized; when the ring
+//    wraps the whole buffer is orphaned with glBufferData(NULL) so the driver hands out
+//    fresh memory instead of waiting for the frames still in flight.
+//
+// Owned by GLBackend; game code reaches it through RenderBackend::streamUpload().
+class StreamBuffer {
+public:
+    // Also used by GLBackend for the entry points glad does not load
+    static bool hasExtension(const char* name) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (extension && std::strcmp(extension, name) == 0) return true;
+        }
+        return false;
+    }
+
+    struct Stats {
+        size_t bytesUploaded = 0;   // bytes copied into the ring
+        int uploads = 0;
+        int stalls = 0;             // fence waits that had to block
+        int orphans = 0;            // ring wraps on the orphan path
+    };
+
+private:
+    struct FencedRange {
+        size_t begin, end;
+        GLsync fence;
+    };
+
+    // A frame fits one full particle emitter, 65536 sprite instances of 128 bytes
+    static const size_t defaultFrameSize = RenderBackend::streamFrameBudget;
+    static const int defaultFrameCount = 3;
+
+    GLuint buffer;
+    size_t capacity;
+    size_t frameCapacity;   // one frame's share of the ring
+    size_t head;
+    size_t frameBegin;
+    bool persistent;
+    unsigned char* mapped;
+
+    std::deque<FencedRange> inFlight;
+
+    Stats frameStats;
+    Stats lastFrameStats;
+
+    // glad is generated without extensions, so on a 3.3 context the ARB entry point is loaded by hand
+    static PFNGLBUFFERSTORAGEPROC loadBufferStorage() {
+        if (GLAD_GL_VERSION_4_4 && glBufferStorage) return glBufferStorage;
+        if (hasExtension("GL_ARB_buffer_storage")) {
+            return reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(glfwGetProcAddress("glBufferStorage"));
+        }
+        return nullptr;
+    }
+
+    // Blocks until nothing in flight overlaps [begin, end)
+    void waitForRange(size_t begin, size_t end) {
+        // Fences signal in submission order: waiting for the newest overlapping
+        // range retires every range before it as well
+        int newest = -1;
+        for (size_t i = 0; i < inFlight.size(); ++i) {
+            if (inFlight[i].begin < end && begin < inFlight[i].end) newest = static_cast<int>(i);
+        }
+        if (newest < 0) return;
+
+        GLsync fence = inFlight[newest].fence;
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            ++frameStats.stalls;
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        for (int i = 0; i <= newest; ++i) {
+            glDeleteSync(inFlight.front().fence);
+            inFlight.pop_front();
+        }
+    }
+
+public:
+    StreamBuffer(size_t frameSize = defaultFrameSize, int frameCount = defaultFrameCount)
+        : capacity(frameSize * frameCount), frameCapacity(frameSize), head(0), frameBegin(0), persistent(false), mapped(nullptr)
+    {
+        glGenBuffers(1, &buffer);
+        GLState& gl = GLState::getInstance();
+        gl.bindBuffer(GL_ARRAY_BUFFER, buffer);
+
+        PFNGLBUFFERSTORAGEPROC bufferStorage = loadBufferStorage();
+        if (bufferStorage) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            bufferStorage(GL_ARRAY_BUFFER, capacity, NULL, flags);
+            mapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, capacity, flags));
+            persistent = mapped != nullptr;
+        }
+
+        if (!persistent) {
+            if (bufferStorage) {
+                // Immutable storage cannot be respecified, start over with a mutable buffer
+                gl.deleteBuffer(buffer);
+                glGenBuffers(1, &buffer);
+                gl.bindBuffer(GL_ARRAY_BUFFER, buffer);
+            }
+            glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+        }
+
+        std::cout << "Stream buffer: " << (capacity >> 20) << " MB, "
+            << (persistent ? "persistent mapping" : "orphaning") << std::endl;
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    GLuint id() const { return buffer; }
+    bool isPersistent() const { return persistent; }
+
+    // Copies bytes into the ring and returns the offset they start at.
+    // alignment lets callers address the data in whole vertices (e.g. base vertex draws).
+    // More than a frame's share of the ring is refused with RenderBackend::streamUploadFailed:
+    // it would overrun the mapping or wait on the fence of the frame writing it.
+    size_t upload(const void* data, size_t bytes, size_t alignment = 16) {
+        if (bytes > frameCapacity) {
+            std::cerr << "Stream buffer: upload of " << bytes << " bytes is larger than a frame's "
+                << frameCapacity << ", dropped" << std::endl;
+            return RenderBackend::streamUploadFailed;
+        }
+        size_t offset = (head + alignment - 1) / alignment * alignment;
+        if (offset + bytes > capacity) {
+            offset = 0;
+            if (!persistent) {
+                GLState::getInstance().bindBuffer(GL_ARRAY_BUFFER, buffer);
+                glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+                ++frameStats.orphans;
+            }
+            else if (frameBegin < head) {
+                // The part of the current frame before the wrap has to be fenced too
+                inFlight.push_back({ frameBegin, head, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+            }
+            frameBegin = 0;
+        }
+
+        if (persistent) {
+            waitForRange(offset, offset + bytes);
+            std::memcpy(mapped + offset, data, bytes);
+        }
+        else {
+            GLState::getInstance().bindBuffer(GL_ARRAY_BUFFER, buffer);
+            void* target = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (target) {
+                std::memcpy(target, data, bytes);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+            }
+        }
+
+        head = offset + bytes;
+        frameStats.bytesUploaded += bytes;
+        ++frameStats.uploads;
+        return offset;
+    }
+
+    // Called once per frame after the swap; fences what the frame wrote
+    void endFrame() {
+        if (persistent && head > frameBegin) {
+            inFlight.push_back({ frameBegin, head, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+        }
+        frameBegin = head;
+        lastFrameStats = frameStats;
+        frameStats = Stats();
+    }
+
+    const Stats& getLastFrameStats() const { return lastFrameStats; }
+
+    void printStats() const {
+        std::cout << "Stream buffer: " << lastFrameStats.bytesUploaded / 1024 << " KB in "
+            << lastFrameStats.uploads << " uploads, " << lastFrameStats.stalls << " stalls, "
+            << lastFrameStats.orphans << " orphans" << std::endl;
+    }
+};
+
+#endif // STREAM_BUFFER_H
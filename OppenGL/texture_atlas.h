@@ -0,0 +1,581 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+
+#include "sprite_batch.h"
+#include "sprite_shape.h"
+#include "texture_cache.h"
+#include "texture_streamer.h"
+#include "texture_compress.h"
+#include "ktx_file.h"
+#include "stb_image.h"
+
+// One frame of a sprite: the texture it lives in, its UV rectangle and the outline of its
+// visible texels (a SpriteShapes index, 0 for frames outside the atlas).
+// texCoords uses the Sprite layout: x/z = u of the left/right edge, y/w = v of the top/bottom edge.
+struct AtlasFrame {
+    TextureHandle texture;
+    Vec4 texCoords;
+    uint32_t shape = 0;
+};
+
+// Skyline bottom-left rectangle packer for a single page
+class SkylinePacker {
+private:
+    struct Node {
+        int x, y, width;
+    };
+
+    int width, height;
+    int usedWidth, usedHeight;
+    std::vector<Node> skyline;
+
+    // Lowest y at which a w-wide rect can sit when its left edge is at skyline[index].x, -1 if it does not fit
+    int fitAt(size_t index, int w, int h) const {
+        int x = skyline[index].x;
+        if (x + w > width) return -1;
+
+        int y = 0;
+        int remaining = w;
+        for (size_t i = index; remaining > 0; ++i) {
+            if (i >= skyline.size()) return -1;
+            y = std::max(y, skyline[i].y);
+            if (y + h > height) return -1;
+            remaining -= skyline[i].width;
+        }
+        return y;
+    }
+
+public:
+    SkylinePacker(int width, int height)
+        : width(width), height(height), usedWidth(0), usedHeight(0) {
+        skyline.push_back({ 0, 0, width });
+    }
+
+    bool insert(int w, int h, int& outX, int& outY) {
+        int bestIndex = -1;
+        int bestTop = height + 1;
+        int bestWidth = width + 1;
+
+        for (size_t i = 0; i < skyline.size(); ++i) {
+            int y = fitAt(i, w, h);
+            if (y < 0) continue;
+            // Prefer the placement with the lowest top edge, then the narrowest skyline segment
+            if (y + h < bestTop || (y + h == bestTop && skyline[i].width < bestWidth)) {
+                bestIndex = static_cast<int>(i);
+                bestTop = y + h;
+                bestWidth = skyline[i].width;
+            }
+        }
+        if (bestIndex < 0) return false;
+
+        outX = skyline[bestIndex].x;
+        outY = bestTop - h;
+
+        Node node = { outX, bestTop, w };
+        skyline.insert(skyline.begin() + bestIndex, node);
+
+        // Trim the segments now covered by the new node
+        for (size_t i = bestIndex + 1; i < skyline.size(); ) {
+            int nodeRight = node.x + node.width;
+            if (skyline[i].x >= nodeRight) break;
+            int shrink = nodeRight - skyline[i].x;
+            skyline[i].x += shrink;
+            skyline[i].width -= shrink;
+            if (skyline[i].width <= 0) {
+                skyline.erase(skyline.begin() + i);
+            }
+            else {
+                break;
+            }
+        }
+
+        // Merge neighbours at the same height
+        for (size_t i = 0; i + 1 < skyline.size(); ) {
+            if (skyline[i].y == skyline[i + 1].y) {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            }
+            else {
+                ++i;
+            }
+        }
+
+        usedWidth = std::max(usedWidth, outX + w);
+        usedHeight = std::max(usedHeight, outY + h);
+        return true;
+    }
+
+    int getUsedWidth() const { return usedWidth; }
+    int getUsedHeight() const { return usedHeight; }
+};
+
+// Packs the cells of every registered sprite sheet into as few textures as possible,
+// so a frame binds one page per filter mode instead of one texture per sheet.
+// Only the visible part of each cell is stored, the transparent margins of the
+// sheets would otherwise take most of the page.
+//
+// Frames of a sheet are numbered like the old calculateTextureCoords grids:
+// left to right, starting from the bottom row of the image.
+class TextureAtlas {
+private:
+    struct SheetDesc {
+        std::string path;
+        int columns, rows;
+        TextureFilter filter;
+    };
+
+    struct Cell {
+        int sheet;
+        int frame;
+        int srcX, srcY, width, height;
+        int page;
+        int x, y;                // where the whole cell would start; only its visible part is stored
+        ShapeBounds bounds;      // visible texels, in the cell
+
+        // The packed part: the bounding box of the visible texels. Sampling never leaves it,
+        // the sprite outline is drawn inside it (a cell without outline is stored whole).
+        int trimmedWidth() const { return bounds.maxX - bounds.minX; }
+        int trimmedHeight() const { return bounds.maxY - bounds.minY; }
+    };
+
+    struct Page {
+        TextureFilter filter;
+        SkylinePacker packer;
+        Page(TextureFilter filter, int size) : filter(filter), packer(size, size) {}
+    };
+
+    static const int padding = 2;
+    static const int maxPageSize = 8192;
+    static const int cookedVersion = 2;
+
+    std::vector<SheetDesc> sheets;
+    std::unordered_map<std::string, std::vector<AtlasFrame>> frameTable;
+
+    // Frames hold cache handles: make sure the cache is constructed first so it is destroyed last
+    TextureAtlas() { TextureCache::getInstance(); }
+
+    static unsigned int uploadPage(const std::vector<unsigned char>& pixels, int width, int height, TextureFilter filter) {
+        TextureDesc desc;
+        desc.width = width;
+        desc.height = height;
+        desc.channels = 4;
+        desc.filter = filter;
+        desc.mipmaps = filter == TextureFilter::Linear;
+        desc.clampToEdge = true;
+        return RenderBackend::get().createTexture(desc, pixels.data());
+    }
+
+    // Frames for a texture that is not in the atlas: the whole file from the cache, cut into a grid
+    static std::vector<AtlasFrame> gridFrames(const std::string& path, int columns, int rows, TextureFilter filter) {
+        // Not in the atlas: loaded in the background, drawn with a placeholder until then
+        TextureHandle texture = TextureStreamer::getInstance().acquire(path, filter);
+        float frameWidth = 1.0f / columns;
+        float frameHeight = 1.0f / rows;
+
+        std::vector<AtlasFrame> frames;
+        for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < columns; ++x) {
+                AtlasFrame frame;
+                frame.texture = texture;
+                frame.texCoords = Vec4(
+                    x * frameWidth,
+                    1.0f - (y + 1) * frameHeight,
+                    (x + 1) * frameWidth,
+                    1.0f - y * frameHeight
+                );
+                frames.push_back(frame);
+            }
+        }
+        return frames;
+    }
+
+    // A composed page before it is uploaded or cooked
+    struct PackedPage {
+        TextureFilter filter;
+        int width, height;
+        std::vector<unsigned char> pixels;
+    };
+
+    // Repeats the border texels of the rectangle into the padding around it, so filtering
+    // and mip levels that reach past the edge see the frame's own colours instead of zeros
+    static void extrude(PackedPage& page, int x, int y, int width, int height) {
+        if (width <= 0 || height <= 0) return;
+        const size_t stride = static_cast<size_t>(page.width) * 4;
+        unsigned char* pixels = page.pixels.data();
+        for (int row = y; row < y + height; ++row) {
+            unsigned char* line = pixels + row * stride;
+            for (int i = 1; i <= padding; ++i) {
+                std::memcpy(line + (x - i) * 4, line + x * 4, 4);
+                std::memcpy(line + (x + width - 1 + i) * 4, line + (x + width - 1) * 4, 4);
+            }
+        }
+        const size_t span = static_cast<size_t>(width + padding * 2) * 4;
+        unsigned char* first = pixels + y * stride + (x - padding) * 4;
+        unsigned char* last = pixels + (y + height - 1) * stride + (x - padding) * 4;
+        for (int i = 1; i <= padding; ++i) {
+            std::memcpy(first - i * stride, first, span);
+            std::memcpy(last + i * stride, last, span);
+        }
+    }
+
+    // Decodes every queued sheet and packs its cells into pages of at most pageSize.
+    // loaded[s] tells whether sheet s was decoded; cells that did not fit keep page -1.
+    void packSheets(int pageSize, std::vector<PackedPage>& packed, std::vector<Cell>& cells, std::vector<bool>& loaded) {
+        // Decode everything up front, the packer needs all cell sizes
+        std::vector<unsigned char*> images(sheets.size(), nullptr);
+        std::vector<int> imageWidths(sheets.size(), 0);
+        loaded.assign(sheets.size(), false);
+        for (size_t s = 0; s < sheets.size(); ++s) {
+            // Compressed blocks cannot be repacked; such a sheet stays its own compressed texture
+            if (TextureCache::hasCompressed(sheets[s].path)) {
+                std::cout << "Atlas: '" << sheets[s].path << "' has a compressed version, it stays a separate texture" << std::endl;
+                continue;
+            }
+            int width, height, nrChannels;
+            images[s] = TextureCache::decodeImage(sheets[s].path, width, height, nrChannels, 4);
+            if (!images[s]) {
+                std::cout << "Texture failed to load at path: " << sheets[s].path << std::endl;
+                continue;
+            }
+            loaded[s] = true;
+            imageWidths[s] = width;
+
+            int cellWidth = width / sheets[s].columns;
+            int cellHeight = height / sheets[s].rows;
+            for (int row = 0; row < sheets[s].rows; ++row) {
+                for (int col = 0; col < sheets[s].columns; ++col) {
+                    Cell cell;
+                    cell.sheet = static_cast<int>(s);
+                    cell.frame = row * sheets[s].columns + col;
+                    cell.srcX = col * cellWidth;
+                    cell.srcY = (sheets[s].rows - 1 - row) * cellHeight;  // rows count from the bottom of the image
+                    cell.width = cellWidth;
+                    cell.height = cellHeight;
+                    cell.page = -1;
+                    cell.bounds = ShapeBounds::fromAlpha(images[s] + (static_cast<size_t>(cell.srcY) * width + cell.srcX) * 4,
+                        static_cast<size_t>(width) * 4, cellWidth, cellHeight);
+                    cells.push_back(cell);
+                }
+            }
+        }
+
+        // Tallest first keeps the skyline flat
+        std::vector<Cell*> order;
+        for (auto& cell : cells) order.push_back(&cell);
+        std::stable_sort(order.begin(), order.end(), [](const Cell* a, const Cell* b) {
+            return a->trimmedHeight() > b->trimmedHeight();
+        });
+
+        std::vector<Page> pages;
+        for (Cell* cell : order) {
+            TextureFilter filter = sheets[cell->sheet].filter;
+            int w = cell->trimmedWidth() + padding * 2;
+            int h = cell->trimmedHeight() + padding * 2;
+            for (size_t p = 0; p < pages.size() && cell->page < 0; ++p) {
+                if (pages[p].filter == filter && pages[p].packer.insert(w, h, cell->x, cell->y)) {
+                    cell->page = static_cast<int>(p);
+                }
+            }
+            if (cell->page < 0) {
+                pages.emplace_back(filter, pageSize);
+                if (pages.back().packer.insert(w, h, cell->x, cell->y)) {
+                    cell->page = static_cast<int>(pages.size() - 1);
+                }
+                else {
+                    pages.pop_back();
+                    std::cout << "Atlas: frame of '" << sheets[cell->sheet].path << "' does not fit into a "
+                        << pageSize << "px page, it stays a separate texture" << std::endl;
+                }
+            }
+            cell->x += padding - cell->bounds.minX;
+            cell->y += padding - cell->bounds.minY;
+        }
+
+        // Compose every page
+        for (size_t p = 0; p < pages.size(); ++p) {
+            PackedPage page;
+            page.filter = pages[p].filter;
+            page.width = pages[p].packer.getUsedWidth();
+            page.height = pages[p].packer.getUsedHeight();
+            page.pixels.assign(static_cast<size_t>(page.width) * page.height * 4, 0);
+
+            for (const auto& cell : cells) {
+                if (cell.page != static_cast<int>(p)) continue;
+                const unsigned char* src = images[cell.sheet];
+                const ShapeBounds& b = cell.bounds;
+                for (int row = b.minY; row < b.maxY; ++row) {
+                    const unsigned char* srcRow = src + (static_cast<size_t>(cell.srcY + row) * imageWidths[cell.sheet] + cell.srcX + b.minX) * 4;
+                    unsigned char* dstRow = page.pixels.data() + (static_cast<size_t>(cell.y + row) * page.width + cell.x + b.minX) * 4;
+                    std::memcpy(dstRow, srcRow, cell.trimmedWidth() * 4);
+                }
+                extrude(page, cell.x + b.minX, cell.y + b.minY, cell.trimmedWidth(), cell.trimmedHeight());
+            }
+            packed.push_back(std::move(page));
+        }
+
+        for (unsigned char* image : images) {
+            stbi_image_free(image);
+        }
+    }
+
+    // Points the frames of every fully packed sheet at their page
+    void placeFrames(const std::vector<Cell>& cells, const std::vector<TextureHandle>& pageTextures, const std::vector<bool>& loaded) {
+        for (size_t s = 0; s < sheets.size(); ++s) {
+            if (!loaded[s]) continue;
+            frameTable[sheets[s].path].resize(sheets[s].columns * sheets[s].rows);
+        }
+
+        int outlines = 0;
+        double area = 0.0;
+        for (const auto& cell : cells) {
+            const SheetDesc& sheet = sheets[cell.sheet];
+            if (cell.page < 0) {
+                frameTable.erase(sheet.path);
+                continue;
+            }
+            auto it = frameTable.find(sheet.path);
+            if (it == frameTable.end()) continue;
+
+            const TextureHandle& page = pageTextures[cell.page];
+            AtlasFrame& frame = it->second[cell.frame];
+            frame.texture = page;
+            frame.shape = SpriteShapes::getInstance().add(cell.bounds, cell.width, cell.height);
+            if (frame.shape != 0) {
+                ++outlines;
+                area += SpriteShapes::getInstance().get(frame.shape).area();
+            }
+            frame.texCoords = Vec4(
+                static_cast<float>(cell.x) / page.width(),
+                static_cast<float>(cell.y) / page.height(),
+                static_cast<float>(cell.x + cell.width) / page.width(),
+                static_cast<float>(cell.y + cell.height) / page.height()
+            );
+        }
+        if (outlines > 0) {
+            std::cout << "Atlas: " << outlines << " of " << cells.size() << " frames trimmed to an outline, "
+                << static_cast<int>(100.0 * area / outlines + 0.5) << "% of their rectangle on average" << std::endl;
+        }
+    }
+
+    static std::string cookedPagePath(const std::string& dir, size_t page) {
+        return dir + "/atlas_" + std::to_string(page) + ".ktx";
+    }
+
+    // Reads a cooked atlas made from exactly the queued sheets; false (nothing created) otherwise
+    bool loadCooked(const std::string& dir) {
+        AssetData manifestFile;
+        if (!AssetPack::getInstance().load(dir + "/atlas.txt", manifestFile)) return false;
+        std::istringstream manifest(manifestFile.str());
+
+        std::string header;
+        int version = 0;
+        manifest >> header >> version;
+        if (header != "atlas" || version != cookedVersion) {
+            std::cout << "Atlas: '" << dir << "/atlas.txt' is from another cooker version, packing at runtime" << std::endl;
+            return false;
+        }
+
+        std::vector<bool> loaded(sheets.size(), false);
+        std::vector<int> pageFilters;
+        std::vector<Cell> cells;
+        size_t sheetCount = 0;
+        std::string kind;
+        while (manifest >> kind) {
+            if (kind == "sheet") {
+                int columns, rows, filter, present;
+                std::string path;
+                manifest >> columns >> rows >> filter >> present >> std::ws;
+                std::getline(manifest, path);
+                const bool matches = sheetCount < sheets.size() && sheets[sheetCount].path == path &&
+                    sheets[sheetCount].columns == columns && sheets[sheetCount].rows == rows &&
+                    static_cast<int>(sheets[sheetCount].filter) == filter;
+                if (!matches) {
+                    std::cout << "Atlas: cooked atlas does not match the registered sheets, packing at runtime" << std::endl;
+                    return false;
+                }
+                loaded[sheetCount++] = present != 0;
+            }
+            else if (kind == "page") {
+                int filter;
+                manifest >> filter;
+                pageFilters.push_back(filter);
+            }
+            else if (kind == "cell") {
+                Cell cell;
+                ShapeBounds& b = cell.bounds;
+                manifest >> cell.sheet >> cell.frame >> cell.page >> cell.x >> cell.y >> cell.width >> cell.height
+                    >> b.minX >> b.maxX >> b.minY >> b.maxY >> b.minSum >> b.maxSum >> b.minDiff >> b.maxDiff;
+                if (cell.sheet < 0 || cell.sheet >= static_cast<int>(sheets.size()) || cell.page >= static_cast<int>(pageFilters.size())) {
+                    std::cout << "Atlas: '" << dir << "/atlas.txt' is damaged, packing at runtime" << std::endl;
+                    return false;
+                }
+                cells.push_back(cell);
+            }
+        }
+        if (sheetCount != sheets.size()) {
+            std::cout << "Atlas: cooked atlas does not match the registered sheets, packing at runtime" << std::endl;
+            return false;
+        }
+
+        // Read every page before creating anything, so a broken file leaves no half-built atlas
+        int maxSize = RenderBackend::get().getMaxTextureSize();
+        std::vector<CompressedImage> images(pageFilters.size());
+        for (size_t p = 0; p < images.size(); ++p) {
+            if (!KTXFile::load(cookedPagePath(dir, p), images[p]) || images[p].width > maxSize || images[p].height > maxSize) {
+                std::cout << "Atlas: cooked page " << p << " is missing or too large, packing at runtime" << std::endl;
+                return false;
+            }
+        }
+
+        std::vector<TextureHandle> pageTextures;
+        for (size_t p = 0; p < images.size(); ++p) {
+            TextureDesc desc;
+            desc.width = images[p].width;
+            desc.height = images[p].height;
+            desc.channels = 4;
+            desc.filter = static_cast<TextureFilter>(pageFilters[p]);
+            desc.mipmaps = images[p].levels.size() > 1;
+            desc.clampToEdge = true;
+            unsigned int id = RenderBackend::get().createCompressedTexture(desc, images[p]);
+            pageTextures.push_back(TextureCache::getInstance().adopt("atlas:" + std::to_string(p), id, desc.width, desc.height));
+            std::cout << "Atlas page " << p << ": " << desc.width << "x" << desc.height << " (cooked)" << std::endl;
+        }
+
+        placeFrames(cells, pageTextures, loaded);
+        sheets.clear();
+        return true;
+    }
+
+public:
+    static TextureAtlas& getInstance() {
+        static TextureAtlas instance;
+        return instance;
+    }
+
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    // Queues a sprite sheet cut into columns x rows equal cells; call build() afterwards
+    void add(const std::string& path, int columns, int rows, TextureFilter filter) {
+        sheets.push_back({ path, columns, rows, filter });
+    }
+
+    // Packs and uploads the queued sheets. With cookedDir set, a cooked atlas made from
+    // the same sheets is loaded from there instead, without decoding a single image.
+    void build(const std::string& cookedDir = "") {
+        if (!cookedDir.empty() && loadCooked(cookedDir)) {
+            return;
+        }
+
+        int pageSize = RenderBackend::get().getMaxTextureSize();
+        if (pageSize > maxPageSize) pageSize = maxPageSize;
+
+        std::vector<PackedPage> packed;
+        std::vector<Cell> cells;
+        std::vector<bool> loaded;
+        packSheets(pageSize, packed, cells, loaded);
+
+        std::vector<TextureHandle> pageTextures;
+        for (size_t p = 0; p < packed.size(); ++p) {
+            unsigned int id = uploadPage(packed[p].pixels, packed[p].width, packed[p].height, packed[p].filter);
+            pageTextures.push_back(TextureCache::getInstance().adopt("atlas:" + std::to_string(p), id, packed[p].width, packed[p].height));
+            std::cout << "Atlas page " << p << ": " << packed[p].width << "x" << packed[p].height << std::endl;
+            std::vector<unsigned char>().swap(packed[p].pixels);
+        }
+
+        placeFrames(cells, pageTextures, loaded);
+        sheets.clear();
+    }
+
+    // Packs the queued sheets and writes them to dir for build(dir): a block-compressed KTX
+    // per page (BC1/BC3, or ETC2 with etc set; linear pages with mips) and a manifest.
+    // The queue is kept, the atlas itself is not built.
+    bool writeCooked(const std::string& dir, bool etc) {
+        std::vector<PackedPage> packed;
+        std::vector<Cell> cells;
+        std::vector<bool> loaded;
+        packSheets(maxPageSize, packed, cells, loaded);
+
+        std::ofstream manifest(dir + "/atlas.txt", std::ios::trunc);
+        if (!manifest) {
+            std::cerr << "Atlas: cannot write '" << dir << "/atlas.txt'" << std::endl;
+            return false;
+        }
+        manifest << "atlas " << cookedVersion << "\n";
+        for (size_t s = 0; s < sheets.size(); ++s) {
+            manifest << "sheet " << sheets[s].columns << ' ' << sheets[s].rows << ' ' << static_cast<int>(sheets[s].filter)
+                << ' ' << (loaded[s] ? 1 : 0) << ' ' << sheets[s].path << "\n";
+        }
+        for (size_t p = 0; p < packed.size(); ++p) {
+            const PackedPage& page = packed[p];
+            CompressedFormat format = TextureCompressor::chooseFormat(page.pixels.data(), page.width, page.height, etc);
+            CompressedImage image = TextureCompressor::compress(page.pixels.data(), page.width, page.height, format,
+                page.filter == TextureFilter::Linear);
+            if (!KTXFile::save(cookedPagePath(dir, p), image)) return false;
+            manifest << "page " << static_cast<int>(page.filter) << "\n";
+        }
+        for (const Cell& cell : cells) {
+            const ShapeBounds& b = cell.bounds;
+            manifest << "cell " << cell.sheet << ' ' << cell.frame << ' ' << cell.page << ' '
+                << cell.x << ' ' << cell.y << ' ' << cell.width << ' ' << cell.height << ' '
+                << b.minX << ' ' << b.maxX << ' ' << b.minY << ' ' << b.maxY << ' '
+                << b.minSum << ' ' << b.maxSum << ' ' << b.minDiff << ' ' << b.maxDiff << "\n";
+        }
+        return static_cast<bool>(manifest);
+    }
+
+    // Source files and layout of the queued sheets, what a cooked atlas depends on
+    std::vector<std::string> getSheetPaths() const {
+        std::vector<std::string> paths;
+        for (const SheetDesc& sheet : sheets) paths.push_back(sheet.path);
+        return paths;
+    }
+
+    std::string describeSheets() const {
+        std::ostringstream description;
+        for (const SheetDesc& sheet : sheets) {
+            description << sheet.path << ' ' << sheet.columns << 'x' << sheet.rows << ' ' << static_cast<int>(sheet.filter) << "\n";
+        }
+        return description.str();
+    }
+
+    // What writeCooked left in dir: the manifest and every page it lists
+    static std::vector<std::string> getCookedFiles(const std::string& dir) {
+        std::vector<std::string> files;
+        std::ifstream manifest(dir + "/atlas.txt");
+        if (!manifest) return files;
+        files.push_back(dir + "/atlas.txt");
+        std::string line;
+        size_t pages = 0;
+        while (std::getline(manifest, line)) {
+            if (line.compare(0, 5, "page ") == 0) files.push_back(cookedPagePath(dir, pages++));
+        }
+        return files;
+    }
+
+    // The frames of a sheet, from the atlas if it was packed, otherwise from a standalone texture
+    std::vector<AtlasFrame> getFrames(const std::string& path, int columns, int rows, TextureFilter filter) {
+        auto it = frameTable.find(path);
+        if (it != frameTable.end() && it->second.size() == static_cast<size_t>(columns * rows)) {
+            return it->second;
+        }
+        return gridFrames(path, columns, rows, filter);
+    }
+
+    AtlasFrame getFrame(const std::string& path, TextureFilter filter) {
+        return getFrames(path, 1, 1, filter)[0];
+    }
+};
+
+#endif // TEXTURE_ATLAS_H
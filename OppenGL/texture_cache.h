@@ -0,0 +1,247 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <iostream>
+
+#include "stb_image.h"
+#include "gl_state.h"
+#include "render_backend.h"
+#include "asset_pack.h"
+#include "ktx_file.h"
+
+struct TextureEntry {
+    std::atomic<unsigned int> id;     // a placeholder until a streamed texture is resident
+    int width, height;
+    std::atomic<int> refCount;        // handles are copied on the simulation and render threads
+    std::string path;
+    bool streaming = false;           // TextureStreamer still holds it
+};
+
+// A texture decoded into memory and ready for upload: a KTX mip chain or stb_image pixels
+struct DecodedTexture {
+    TextureDesc desc;
+    bool isCompressed = false;
+    CompressedImage compressed;
+    std::unique_ptr<unsigned char, void(*)(void*)> pixels{ nullptr, stbi_image_free };
+
+    size_t bytes() const {
+        if (isCompressed) {
+            size_t total = 0;
+            for (const auto& level : compressed.levels) total += level.size();
+            return total;
+        }
+        return static_cast<size_t>(desc.width) * desc.height * desc.channels;
+    }
+};
+
+// Shared reference to a texture owned by the TextureCache.
+// Copying a handle adds a reference, destroying it releases one; the GL texture
+// itself stays alive in the cache when the last handle goes away.
+class TextureHandle {
+private:
+    TextureEntry* entry;
+
+public:
+    TextureHandle() : entry(nullptr) {}
+
+    explicit TextureHandle(TextureEntry* entry) : entry(entry) {
+        if (entry) ++entry->refCount;
+    }
+
+    TextureHandle(const TextureHandle& other) : entry(other.entry) {
+        if (entry) ++entry->refCount;
+    }
+
+    TextureHandle(TextureHandle&& other) noexcept : entry(other.entry) {
+        other.entry = nullptr;
+    }
+
+    TextureHandle& operator=(TextureHandle other) {
+        std::swap(entry, other.entry);
+        return *this;
+    }
+
+    ~TextureHandle() {
+        if (entry) --entry->refCount;
+    }
+
+    unsigned int id() const { return entry ? entry->id.load() : 0; }
+    int width() const { return entry ? entry->width : 0; }
+    int height() const { return entry ? entry->height : 0; }
+    bool valid() const { return entry != nullptr && entry->id != 0; }
+};
+
+// Process-wide texture cache. Every image is decoded and uploaded once, the first
+// time it is acquired, and kept resident while anything holds a handle to it.
+// GameState purges the rest on every level change, after the new level has acquired
+// its textures, so restarting a level or sharing a sheet never touches the disk again.
+class TextureCache {
+private:
+    std::unordered_map<std::string, std::unique_ptr<TextureEntry>> entries;
+
+    TextureCache() = default;
+
+    static unsigned int loadTexture(const char* path, TextureFilter filter, int& width, int& height) {
+        DecodedTexture texture;
+        if (!decodeTexture(path, filter, texture)) {
+            width = height = 0;
+            return 0;
+        }
+        width = texture.desc.width;
+        height = texture.desc.height;
+        return uploadTexture(texture, false);
+    }
+
+public:
+    static TextureCache& getInstance() {
+        static TextureCache instance;
+        return instance;
+    }
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // The file part of loading a texture; touches no GL state, so any thread may call it.
+    // A cooked, block-compressed version with its mip chain wins over the source image.
+    static bool decodeTexture(const std::string& path, TextureFilter filter, DecodedTexture& texture) {
+        TextureDesc& desc = texture.desc;
+        desc.filter = filter;
+        desc.clampToEdge = false;
+
+        if (KTXFile::load(compressedPath(path), texture.compressed)) {
+            texture.isCompressed = true;
+            desc.width = texture.compressed.width;
+            desc.height = texture.compressed.height;
+            desc.channels = 4;
+            desc.mipmaps = texture.compressed.levels.size() > 1;
+            return true;
+        }
+
+        int nrComponents;
+        texture.pixels.reset(decodeImage(path, desc.width, desc.height, nrComponents, filter == TextureFilter::Nearest ? 4 : 0));
+        if (!texture.pixels) {
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+            return false;
+        }
+        desc.channels = filter == TextureFilter::Nearest ? 4 : nrComponents;
+        desc.mipmaps = true;
+        return true;
+    }
+
+    // The GL part: creates the texture from what decodeTexture produced
+    static unsigned int uploadTexture(const DecodedTexture& texture, bool streamed) {
+        if (texture.isCompressed) {
+            return RenderBackend::get().createCompressedTexture(texture.desc, texture.compressed);
+        }
+        if (streamed) {
+            return RenderBackend::get().createTextureStreamed(texture.desc, texture.pixels.get());
+        }
+        return RenderBackend::get().createTexture(texture.desc, texture.pixels.get());
+    }
+
+    // stbi_load through the asset pack: the image is decoded straight from the mapped file
+    static unsigned char* decodeImage(const std::string& path, int& width, int& height, int& channels, int desiredChannels) {
+        AssetData file;
+        if (!AssetPack::getInstance().load(path, file)) return nullptr;
+        return stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &channels, desiredChannels);
+    }
+
+    // Where the cooked version of an image lives: the same name with a .ktx extension
+    static std::string compressedPath(const std::string& path) {
+        size_t dot = path.find_last_of('.');
+        size_t slash = path.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path + ".ktx";
+        return path.substr(0, dot) + ".ktx";
+    }
+
+    static bool hasCompressed(const std::string& path) {
+        return KTXFile::exists(compressedPath(path));
+    }
+
+    TextureHandle acquire(const std::string& path, TextureFilter filter) {
+        // The same file can be requested with both filters, each gets its own texture
+        std::string key = path + (filter == TextureFilter::Nearest ? "|nearest" : "|linear");
+
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            return TextureHandle(it->second.get());
+        }
+
+        std::unique_ptr<TextureEntry> entry(new TextureEntry());
+        entry->path = path;
+        entry->refCount = 0;
+        entry->id = loadTexture(path.c_str(), filter, entry->width, entry->height);
+
+        TextureEntry* raw = entry.get();
+        entries.emplace(key, std::move(entry));
+        return TextureHandle(raw);
+    }
+
+    // For TextureStreamer: the entry for path, created with placeholder as its texture if it
+    // does not exist yet. created tells the caller that it has to fill it in.
+    TextureHandle reserve(const std::string& path, TextureFilter filter, unsigned int placeholder, TextureEntry*& created) {
+        std::string key = path + (filter == TextureFilter::Nearest ? "|nearest" : "|linear");
+        created = nullptr;
+
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            return TextureHandle(it->second.get());
+        }
+
+        std::unique_ptr<TextureEntry> entry(new TextureEntry());
+        entry->path = path;
+        entry->refCount = 0;
+        entry->id = placeholder;
+        entry->width = entry->height = 1;
+        entry->streaming = true;
+
+        created = entry.get();
+        entries.emplace(key, std::move(entry));
+        return TextureHandle(created);
+    }
+
+    // Registers a texture created elsewhere (e.g. an atlas page) so it can be
+    // shared through handles like any loaded file. The cache takes ownership;
+    // the key must not be in use yet.
+    TextureHandle adopt(const std::string& key, unsigned int id, int width, int height) {
+        if (entries.count(key)) {
+            std::cerr << "Warning: texture key '" << key << "' is already in the cache" << std::endl;
+            GLState::getInstance().deleteTexture(id);
+            return TextureHandle(entries[key].get());
+        }
+
+        std::unique_ptr<TextureEntry> entry(new TextureEntry());
+        entry->path = key;
+        entry->refCount = 0;
+        entry->id = id;
+        entry->width = width;
+        entry->height = height;
+
+        TextureEntry* raw = entry.get();
+        entries.emplace(key, std::move(entry));
+        return TextureHandle(raw);
+    }
+
+    // Frees every texture nobody holds a handle to any more; on the render thread
+    void purgeUnused() {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->second->refCount == 0 && !it->second->streaming) {
+                GLState::getInstance().deleteTexture(it->second->id);
+                it = entries.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    size_t size() const { return entries.size(); }
+};
+
+#endif // TEXTURE_CACHE_H
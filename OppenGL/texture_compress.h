@@ -0,0 +1,732 @@
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <emmintrin.h>
+
+#include "render_backend.h"
+
+// Not part of the core profile loader; the values come from EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// CPU encoder and decoder for the block-compressed formats, meant for asset cooking.
+// Encoding is a fast fit rather than an exhaustive search:
+//  - BC1/BC3 colour: inset bounding box along the covariance diagonal, SSE2 index selection
+//  - BC3 alpha: both the 8-value and the 6-value (explicit 0 and 255) ramps, the better one wins
+//  - ETC2 RGB: the ETC1-compatible individual and differential modes, both flips, every table
+//  - ETC2 alpha (EAC): every table with the multiplier fitted to the block's alpha range
+// The ETC2-only T, H and planar modes are never emitted. The decoder does not support them
+// either and shows such blocks as magenta.
+//
+// Images are RGBA8, rows top to bottom; sizes that are not multiples of 4 repeat the edge texels.
+class TextureCompressor {
+private:
+    static const int etcModifiers[8][2];
+    static const int eacModifiers[16][8];
+
+    static uint8_t clampByte(int value) {
+        return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+    }
+
+    // 4x4 texels starting at (x, y), clamped to the image
+    static void fetchBlock(const unsigned char* rgba, int width, int height, int x, int y, uint8_t block[64]) {
+        for (int row = 0; row < 4; ++row) {
+            int sy = std::min(y + row, height - 1);
+            for (int col = 0; col < 4; ++col) {
+                int sx = std::min(x + col, width - 1);
+                std::memcpy(block + (row * 4 + col) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+            }
+        }
+    }
+
+    static void storeBlock(const uint8_t block[64], unsigned char* rgba, int width, int height, int x, int y) {
+        for (int row = 0; row < 4 && y + row < height; ++row) {
+            for (int col = 0; col < 4 && x + col < width; ++col) {
+                std::memcpy(rgba + (static_cast<size_t>(y + row) * width + x + col) * 4, block + (row * 4 + col) * 4, 4);
+            }
+        }
+    }
+
+    static uint16_t pack565(int r, int g, int b) {
+        return static_cast<uint16_t>((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+    }
+
+    static void unpack565(uint16_t c, int out[3]) {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        out[0] = (r << 3) | (r >> 2);
+        out[1] = (g << 2) | (g >> 4);
+        out[2] = (b << 3) | (b >> 2);
+    }
+
+    static uint32_t packColor(const int c[3]) {
+        return static_cast<uint32_t>(c[0]) | (static_cast<uint32_t>(c[1]) << 8) | (static_cast<uint32_t>(c[2]) << 16);
+    }
+
+    // Per-channel min and max of 16 RGBA texels
+    static void boundingBox(const uint8_t block[64], uint8_t minColor[4], uint8_t maxColor[4]) {
+        const __m128i* texels = reinterpret_cast<const __m128i*>(block);
+        __m128i lo = _mm_loadu_si128(texels);
+        __m128i hi = lo;
+        for (int i = 1; i < 4; ++i) {
+            __m128i v = _mm_loadu_si128(texels + i);
+            lo = _mm_min_epu8(lo, v);
+            hi = _mm_max_epu8(hi, v);
+        }
+        lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2)));
+        lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+        hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2)));
+        hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+        uint32_t packedLo = static_cast<uint32_t>(_mm_cvtsi128_si32(lo));
+        uint32_t packedHi = static_cast<uint32_t>(_mm_cvtsi128_si32(hi));
+        std::memcpy(minColor, &packedLo, 4);
+        std::memcpy(maxColor, &packedHi, 4);
+    }
+
+    // Squared RGB distance of 4 texels to one colour, alpha ignored
+    static __m128i distances(__m128i texels, __m128i color) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i dLo = _mm_sub_epi16(_mm_unpacklo_epi8(texels, zero), _mm_unpacklo_epi8(color, zero));
+        __m128i dHi = _mm_sub_epi16(_mm_unpackhi_epi8(texels, zero), _mm_unpackhi_epi8(color, zero));
+        __m128 sLo = _mm_castsi128_ps(_mm_madd_epi16(dLo, dLo));   // r2+g2, b2 per texel, texels 0 and 1
+        __m128 sHi = _mm_castsi128_ps(_mm_madd_epi16(dHi, dHi));   // texels 2 and 3
+        __m128i even = _mm_castps_si128(_mm_shuffle_ps(sLo, sHi, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odd = _mm_castps_si128(_mm_shuffle_ps(sLo, sHi, _MM_SHUFFLE(3, 1, 3, 1)));
+        return _mm_add_epi32(even, odd);
+    }
+
+    // Nearest of the first paletteSize palette colours for every texel, 4 texels at a time
+    static void selectIndices(const uint8_t block[64], const uint32_t palette[4], int paletteSize, uint8_t indices[16]) {
+        const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+        for (int group = 0; group < 4; ++group) {
+            __m128i texels = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block) + group), rgbMask);
+            __m128i best = _mm_set1_epi32(0x7FFFFFFF);
+            __m128i bestIndex = _mm_setzero_si128();
+            for (int p = 0; p < paletteSize; ++p) {
+                __m128i d = distances(texels, _mm_set1_epi32(static_cast<int>(palette[p] & 0x00FFFFFF)));
+                __m128i closer = _mm_cmplt_epi32(d, best);
+                best = _mm_or_si128(_mm_and_si128(closer, d), _mm_andnot_si128(closer, best));
+                bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+            }
+            int32_t lanes[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+            for (int i = 0; i < 4; ++i) indices[group * 4 + i] = static_cast<uint8_t>(lanes[i]);
+        }
+    }
+
+    // BC1 colour block. allowTransparent picks the 3-colour mode for blocks with texels below alpha 128;
+    // BC3 colour blocks are always read in 4-colour mode and pass false.
+    static void encodeColorBlock(const uint8_t block[64], uint8_t out[8], bool allowTransparent) {
+        uint8_t work[64];
+        std::memcpy(work, block, 64);
+
+        bool transparent[16] = {};
+        int opaque = -1;
+        bool anyTransparent = false;
+        for (int i = 0; i < 16; ++i) {
+            transparent[i] = allowTransparent && block[i * 4 + 3] < 128;
+            anyTransparent = anyTransparent || transparent[i];
+            if (!transparent[i] && opaque < 0) opaque = i;
+        }
+        if (opaque < 0) {
+            // Nothing visible: both endpoints black in 3-colour mode, every index transparent
+            std::memset(out, 0, 4);
+            std::memset(out + 4, 0xFF, 4);
+            return;
+        }
+        // Transparent texels must not stretch the endpoints
+        for (int i = 0; i < 16; ++i) {
+            if (transparent[i]) std::memcpy(work + i * 4, block + opaque * 4, 4);
+        }
+
+        uint8_t minColor[4], maxColor[4];
+        boundingBox(work, minColor, maxColor);
+        int lo[3], hi[3], centre[3];
+        for (int c = 0; c < 3; ++c) {
+            int inset = (maxColor[c] - minColor[c]) >> 4;
+            lo[c] = minColor[c] + inset;
+            hi[c] = maxColor[c] - inset;
+            centre[c] = (minColor[c] + maxColor[c]) / 2;
+        }
+
+        // Pick the box diagonal that follows the colours: flip red and blue against green as needed
+        int covRG = 0, covBG = 0;
+        for (int i = 0; i < 16; ++i) {
+            int g = work[i * 4 + 1] - centre[1];
+            covRG += (work[i * 4] - centre[0]) * g;
+            covBG += (work[i * 4 + 2] - centre[2]) * g;
+        }
+        if (covRG < 0) std::swap(lo[0], hi[0]);
+        if (covBG < 0) std::swap(lo[2], hi[2]);
+
+        uint16_t c0 = pack565(hi[0], hi[1], hi[2]);
+        uint16_t c1 = pack565(lo[0], lo[1], lo[2]);
+        bool threeColor = anyTransparent;
+        if (threeColor ? c0 > c1 : c0 < c1) std::swap(c0, c1);
+
+        uint8_t indices[16] = {};
+        if (c0 != c1 || threeColor) {
+            int p0[3], p1[3];
+            unpack565(c0, p0);
+            unpack565(c1, p1);
+            uint32_t palette[4];
+            palette[0] = packColor(p0);
+            palette[1] = packColor(p1);
+            int p2[3], p3[3];
+            for (int c = 0; c < 3; ++c) {
+                p2[c] = threeColor ? (p0[c] + p1[c]) / 2 : (2 * p0[c] + p1[c]) / 3;
+                p3[c] = (p0[c] + 2 * p1[c]) / 3;
+            }
+            palette[2] = packColor(p2);
+            palette[3] = packColor(p3);
+            selectIndices(work, palette, threeColor ? 3 : 4, indices);
+            for (int i = 0; i < 16; ++i) {
+                if (transparent[i]) indices[i] = 3;
+            }
+        }
+
+        out[0] = static_cast<uint8_t>(c0);
+        out[1] = static_cast<uint8_t>(c0 >> 8);
+        out[2] = static_cast<uint8_t>(c1);
+        out[3] = static_cast<uint8_t>(c1 >> 8);
+        for (int row = 0; row < 4; ++row) {
+            out[4 + row] = static_cast<uint8_t>(indices[row * 4] | (indices[row * 4 + 1] << 2) |
+                (indices[row * 4 + 2] << 4) | (indices[row * 4 + 3] << 6));
+        }
+    }
+
+    static void decodeColorBlock(const uint8_t in[8], uint8_t block[64], bool fourColorOnly) {
+        uint16_t c0 = static_cast<uint16_t>(in[0] | (in[1] << 8));
+        uint16_t c1 = static_cast<uint16_t>(in[2] | (in[3] << 8));
+        int palette[4][4];
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+        for (int c = 0; c < 3; ++c) {
+            if (c0 > c1 || fourColorOnly) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            else {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        if (!(c0 > c1 || fourColorOnly)) palette[3][3] = 0;
+
+        for (int i = 0; i < 16; ++i) {
+            int index = (in[4 + i / 4] >> ((i % 4) * 2)) & 3;
+            for (int c = 0; c < 4; ++c) block[i * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+        }
+    }
+
+    // Alpha ramp of a BC3 block: 8 interpolated values if a0 > a1, else 6 plus 0 and 255
+    static void alphaRamp(int a0, int a1, int ramp[8]) {
+        ramp[0] = a0;
+        ramp[1] = a1;
+        if (a0 > a1) {
+            for (int i = 2; i < 8; ++i) ramp[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+        }
+        else {
+            for (int i = 2; i < 6; ++i) ramp[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+            ramp[6] = 0;
+            ramp[7] = 255;
+        }
+    }
+
+    static int fitAlpha(const uint8_t block[64], const int ramp[8], uint8_t indices[16]) {
+        int error = 0;
+        for (int i = 0; i < 16; ++i) {
+            int a = block[i * 4 + 3];
+            int best = 0, bestError = 1 << 30;
+            for (int r = 0; r < 8; ++r) {
+                int d = (ramp[r] - a) * (ramp[r] - a);
+                if (d < bestError) { bestError = d; best = r; }
+            }
+            indices[i] = static_cast<uint8_t>(best);
+            error += bestError;
+        }
+        return error;
+    }
+
+    static void encodeAlphaBlock(const uint8_t block[64], uint8_t out[8]) {
+        int minAll = 255, maxAll = 0, minInner = 255, maxInner = 0;
+        for (int i = 0; i < 16; ++i) {
+            int a = block[i * 4 + 3];
+            minAll = std::min(minAll, a);
+            maxAll = std::max(maxAll, a);
+            if (a != 0 && a != 255) {
+                minInner = std::min(minInner, a);
+                maxInner = std::max(maxInner, a);
+            }
+        }
+
+        int a0 = maxAll, a1 = minAll;
+        uint8_t indices[16] = {};
+        if (a0 != a1) {
+            int ramp[8];
+            alphaRamp(a0, a1, ramp);
+            int error = fitAlpha(block, ramp, indices);
+
+            // The 6-value ramp keeps exact 0 and 255, which suits sprite edges
+            if (error > 0) {
+                if (minInner > maxInner) minInner = maxInner = minAll;
+                int b0 = minInner, b1 = maxInner;
+                uint8_t other[16];
+                alphaRamp(b0, b1, ramp);
+                if (fitAlpha(block, ramp, other) < error) {
+                    a0 = b0;
+                    a1 = b1;
+                    std::memcpy(indices, other, 16);
+                }
+            }
+        }
+
+        out[0] = static_cast<uint8_t>(a0);
+        out[1] = static_cast<uint8_t>(a1);
+        uint64_t bits = 0;
+        for (int i = 0; i < 16; ++i) bits |= static_cast<uint64_t>(indices[i]) << (3 * i);
+        for (int i = 0; i < 6; ++i) out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+
+    static void decodeAlphaBlock(const uint8_t in[8], uint8_t block[64]) {
+        int ramp[8];
+        alphaRamp(in[0], in[1], ramp);
+        uint64_t bits = 0;
+        for (int i = 0; i < 6; ++i) bits |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+        for (int i = 0; i < 16; ++i) block[i * 4 + 3] = static_cast<uint8_t>(ramp[(bits >> (3 * i)) & 7]);
+    }
+
+    static void writeBigEndian(uint64_t bits, uint8_t out[8]) {
+        for (int i = 0; i < 8; ++i) out[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    }
+
+    static uint64_t readBigEndian(const uint8_t in[8]) {
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) bits = (bits << 8) | in[i];
+        return bits;
+    }
+
+    // Texel i (row-major) of an ETC block sits in the column-major bit position x * 4 + y
+    static int etcBit(int texel) {
+        return (texel % 4) * 4 + texel / 4;
+    }
+
+    static bool inSecondHalf(int texel, bool flip) {
+        return flip ? texel / 4 >= 2 : texel % 4 >= 2;
+    }
+
+    // Best modifier table for one half block around base; returns the error and fills the texel indices
+    static int fitEtcHalf(const uint8_t block[64], bool flip, int half, const int base[3], int& table, uint8_t indices[16]) {
+        int bestError = 1 << 30;
+        for (int t = 0; t < 8; ++t) {
+            int error = 0;
+            uint8_t chosen[16];
+            for (int i = 0; i < 16; ++i) {
+                if (inSecondHalf(i, flip) != (half == 1)) continue;
+                int best = 0, bestTexelError = 1 << 30;
+                for (int m = 0; m < 4; ++m) {
+                    int modifier = (m & 2 ? -1 : 1) * etcModifiers[t][m & 1];
+                    int d = 0;
+                    for (int c = 0; c < 3; ++c) {
+                        int diff = clampByte(base[c] + modifier) - block[i * 4 + c];
+                        d += diff * diff;
+                    }
+                    if (d < bestTexelError) { bestTexelError = d; best = m; }
+                }
+                chosen[i] = static_cast<uint8_t>(best);
+                error += bestTexelError;
+                if (error >= bestError) break;
+            }
+            if (error < bestError) {
+                bestError = error;
+                table = t;
+                for (int i = 0; i < 16; ++i) {
+                    if (inSecondHalf(i, flip) == (half == 1)) indices[i] = chosen[i];
+                }
+            }
+        }
+        return bestError;
+    }
+
+    static void encodeEtcBlock(const uint8_t block[64], uint8_t out[8]) {
+        uint64_t bestBits = 0;
+        int bestError = 1 << 30;
+
+        for (int flip = 0; flip < 2; ++flip) {
+            int average[2][3] = {};
+            for (int i = 0; i < 16; ++i) {
+                int half = inSecondHalf(i, flip != 0) ? 1 : 0;
+                for (int c = 0; c < 3; ++c) average[half][c] += block[i * 4 + c];
+            }
+            for (int half = 0; half < 2; ++half) {
+                for (int c = 0; c < 3; ++c) average[half][c] = (average[half][c] + 4) / 8;
+            }
+
+            for (int differential = 0; differential < 2; ++differential) {
+                int quantized[2][3], base[2][3];
+                bool valid = true;
+                for (int half = 0; half < 2; ++half) {
+                    for (int c = 0; c < 3; ++c) {
+                        if (differential) {
+                            int q = (average[half][c] * 31 + 127) / 255;
+                            quantized[half][c] = q;
+                            base[half][c] = (q << 3) | (q >> 2);
+                        }
+                        else {
+                            int q = (average[half][c] * 15 + 127) / 255;
+                            quantized[half][c] = q;
+                            base[half][c] = (q << 4) | q;
+                        }
+                    }
+                }
+                if (differential) {
+                    for (int c = 0; c < 3; ++c) {
+                        int delta = quantized[1][c] - quantized[0][c];
+                        if (delta < -4 || delta > 3) valid = false;
+                    }
+                }
+                if (!valid) continue;
+
+                int tables[2];
+                uint8_t indices[16];
+                int error = fitEtcHalf(block, flip != 0, 0, base[0], tables[0], indices) +
+                    fitEtcHalf(block, flip != 0, 1, base[1], tables[1], indices);
+                if (error >= bestError) continue;
+                bestError = error;
+
+                uint64_t bits = 0;
+                if (differential) {
+                    bits |= static_cast<uint64_t>(quantized[0][0]) << 59;
+                    bits |= static_cast<uint64_t>((quantized[1][0] - quantized[0][0]) & 7) << 56;
+                    bits |= static_cast<uint64_t>(quantized[0][1]) << 51;
+                    bits |= static_cast<uint64_t>((quantized[1][1] - quantized[0][1]) & 7) << 48;
+                    bits |= static_cast<uint64_t>(quantized[0][2]) << 43;
+                    bits |= static_cast<uint64_t>((quantized[1][2] - quantized[0][2]) & 7) << 40;
+                }
+                else {
+                    bits |= static_cast<uint64_t>(quantized[0][0]) << 60;
+                    bits |= static_cast<uint64_t>(quantized[1][0]) << 56;
+                    bits |= static_cast<uint64_t>(quantized[0][1]) << 52;
+                    bits |= static_cast<uint64_t>(quantized[1][1]) << 48;
+                    bits |= static_cast<uint64_t>(quantized[0][2]) << 44;
+                    bits |= static_cast<uint64_t>(quantized[1][2]) << 40;
+                }
+                bits |= static_cast<uint64_t>(tables[0]) << 37;
+                bits |= static_cast<uint64_t>(tables[1]) << 34;
+                bits |= static_cast<uint64_t>(differential) << 33;
+                bits |= static_cast<uint64_t>(flip) << 32;
+                for (int i = 0; i < 16; ++i) {
+                    int bit = etcBit(i);
+                    bits |= static_cast<uint64_t>(indices[i] >> 1) << (16 + bit);
+                    bits |= static_cast<uint64_t>(indices[i] & 1) << bit;
+                }
+                bestBits = bits;
+            }
+        }
+        writeBigEndian(bestBits, out);
+    }
+
+    static void decodeEtcBlock(const uint8_t in[8], uint8_t block[64]) {
+        uint64_t bits = readBigEndian(in);
+        bool differential = (bits >> 33) & 1;
+        bool flip = (bits >> 32) & 1;
+
+        int base[2][3];
+        for (int c = 0; c < 3; ++c) {
+            int shift = 59 - 8 * c;
+            if (differential) {
+                int q0 = static_cast<int>((bits >> shift) & 31);
+                int delta = static_cast<int>((bits >> (shift - 3)) & 7);
+                if (delta >= 4) delta -= 8;
+                int q1 = q0 + delta;
+                if (q1 < 0 || q1 > 31) {
+                    // T, H or planar block
+                    for (int i = 0; i < 16; ++i) {
+                        block[i * 4] = 255; block[i * 4 + 1] = 0; block[i * 4 + 2] = 255;
+                    }
+                    return;
+                }
+                base[0][c] = (q0 << 3) | (q0 >> 2);
+                base[1][c] = (q1 << 3) | (q1 >> 2);
+            }
+            else {
+                int q0 = static_cast<int>((bits >> (shift + 1)) & 15);
+                int q1 = static_cast<int>((bits >> (shift - 3)) & 15);
+                base[0][c] = (q0 << 4) | q0;
+                base[1][c] = (q1 << 4) | q1;
+            }
+        }
+        int tables[2] = { static_cast<int>((bits >> 37) & 7), static_cast<int>((bits >> 34) & 7) };
+
+        for (int i = 0; i < 16; ++i) {
+            int half = inSecondHalf(i, flip) ? 1 : 0;
+            int bit = etcBit(i);
+            int m = static_cast<int>((((bits >> (16 + bit)) & 1) << 1) | ((bits >> bit) & 1));
+            int modifier = (m & 2 ? -1 : 1) * etcModifiers[tables[half]][m & 1];
+            for (int c = 0; c < 3; ++c) block[i * 4 + c] = clampByte(base[half][c] + modifier);
+        }
+    }
+
+    static int fitEac(const uint8_t block[64], int base, int multiplier, int table, uint64_t* indexBits) {
+        int error = 0;
+        uint64_t bits = 0;
+        for (int i = 0; i < 16; ++i) {
+            int a = block[i * 4 + 3];
+            int best = 0, bestError = 1 << 30;
+            for (int m = 0; m < 8; ++m) {
+                int d = clampByte(base + eacModifiers[table][m] * multiplier) - a;
+                if (d * d < bestError) { bestError = d * d; best = m; }
+            }
+            error += bestError;
+            bits |= static_cast<uint64_t>(best) << (45 - 3 * etcBit(i));
+        }
+        if (indexBits) *indexBits = bits;
+        return error;
+    }
+
+    static void encodeEacBlock(const uint8_t block[64], uint8_t out[8]) {
+        int minA = 255, maxA = 0;
+        for (int i = 0; i < 16; ++i) {
+            minA = std::min<int>(minA, block[i * 4 + 3]);
+            maxA = std::max<int>(maxA, block[i * 4 + 3]);
+        }
+
+        // Table 13 has a zero modifier, so a flat block is exact with any multiplier
+        int bestBase = minA, bestMultiplier = 1, bestTable = 13;
+        int bestError = fitEac(block, bestBase, bestMultiplier, bestTable, nullptr);
+        for (int table = 0; table < 16 && bestError > 0; ++table) {
+            const int* t = eacModifiers[table];
+            int range = t[7] - t[3];
+            int fitted = (maxA - minA + range / 2) / range;
+            for (int multiplier = std::max(1, fitted - 1); multiplier <= std::min(15, fitted + 1); ++multiplier) {
+                int centre = (minA + maxA) / 2 - (t[3] + t[7]) * multiplier / 2;
+                for (int base = std::max(0, centre - 2); base <= std::min(255, centre + 2); ++base) {
+                    int error = fitEac(block, base, multiplier, table, nullptr);
+                    if (error < bestError) {
+                        bestError = error;
+                        bestBase = base;
+                        bestMultiplier = multiplier;
+                        bestTable = table;
+                    }
+                }
+            }
+        }
+
+        uint64_t bits;
+        fitEac(block, bestBase, bestMultiplier, bestTable, &bits);
+        bits |= static_cast<uint64_t>(bestBase) << 56;
+        bits |= static_cast<uint64_t>(bestMultiplier) << 52;
+        bits |= static_cast<uint64_t>(bestTable) << 48;
+        writeBigEndian(bits, out);
+    }
+
+    static void decodeEacBlock(const uint8_t in[8], uint8_t block[64]) {
+        uint64_t bits = readBigEndian(in);
+        int base = static_cast<int>(bits >> 56);
+        int multiplier = static_cast<int>((bits >> 52) & 15);
+        int table = static_cast<int>((bits >> 48) & 15);
+        for (int i = 0; i < 16; ++i) {
+            int m = static_cast<int>((bits >> (45 - 3 * etcBit(i))) & 7);
+            block[i * 4 + 3] = clampByte(base + eacModifiers[table][m] * multiplier);
+        }
+    }
+
+    static void encodeBlock(CompressedFormat format, const uint8_t block[64], uint8_t* out) {
+        switch (format) {
+        case CompressedFormat::BC1:
+            encodeColorBlock(block, out, true);
+            break;
+        case CompressedFormat::BC3:
+            encodeAlphaBlock(block, out);
+            encodeColorBlock(block, out + 8, false);
+            break;
+        case CompressedFormat::ETC2_RGB:
+            encodeEtcBlock(block, out);
+            break;
+        case CompressedFormat::ETC2_RGBA:
+            encodeEacBlock(block, out);
+            encodeEtcBlock(block, out + 8);
+            break;
+        }
+    }
+
+    static void decodeBlock(CompressedFormat format, const uint8_t* in, uint8_t block[64]) {
+        switch (format) {
+        case CompressedFormat::BC1:
+            decodeColorBlock(in, block, false);
+            break;
+        case CompressedFormat::BC3:
+            decodeColorBlock(in + 8, block, true);
+            decodeAlphaBlock(in, block);
+            break;
+        case CompressedFormat::ETC2_RGB:
+            decodeEtcBlock(in, block);
+            for (int i = 0; i < 16; ++i) block[i * 4 + 3] = 255;
+            break;
+        case CompressedFormat::ETC2_RGBA:
+            decodeEtcBlock(in + 8, block);
+            decodeEacBlock(in, block);
+            break;
+        }
+    }
+
+    // Half size with a 2x2 box filter; odd edges reuse their last texel
+    static std::vector<unsigned char> downsample(const unsigned char* rgba, int width, int height, int& outWidth, int& outHeight) {
+        outWidth = std::max(1, width / 2);
+        outHeight = std::max(1, height / 2);
+        std::vector<unsigned char> out(static_cast<size_t>(outWidth) * outHeight * 4);
+        for (int y = 0; y < outHeight; ++y) {
+            int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            for (int x = 0; x < outWidth; ++x) {
+                int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+                for (int c = 0; c < 4; ++c) {
+                    int sum = rgba[(static_cast<size_t>(y0) * width + x0) * 4 + c] + rgba[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+                        rgba[(static_cast<size_t>(y1) * width + x0) * 4 + c] + rgba[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+                    out[(static_cast<size_t>(y) * outWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+        return out;
+    }
+
+    static std::vector<unsigned char> compressLevel(const unsigned char* rgba, int width, int height, CompressedFormat format) {
+        int blockSize = blockBytes(format);
+        int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        std::vector<unsigned char> out(static_cast<size_t>(blocksX) * blocksY * blockSize);
+        uint8_t block[64];
+        for (int by = 0; by < blocksY; ++by) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                fetchBlock(rgba, width, height, bx * 4, by * 4, block);
+                encodeBlock(format, block, out.data() + (static_cast<size_t>(by) * blocksX + bx) * blockSize);
+            }
+        }
+        return out;
+    }
+
+public:
+    static int blockBytes(CompressedFormat format) {
+        return format == CompressedFormat::BC1 || format == CompressedFormat::ETC2_RGB ? 8 : 16;
+    }
+
+    static size_t levelBytes(CompressedFormat format, int width, int height) {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+    }
+
+    static bool hasAlpha(CompressedFormat format) {
+        return format != CompressedFormat::ETC2_RGB;
+    }
+
+    static GLenum glInternalFormat(CompressedFormat format) {
+        switch (format) {
+        case CompressedFormat::BC1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case CompressedFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case CompressedFormat::ETC2_RGB: return GL_COMPRESSED_RGB8_ETC2;
+        case CompressedFormat::ETC2_RGBA: return GL_COMPRESSED_RGBA8_ETC2_EAC;
+        }
+        return 0;
+    }
+
+    static bool fromGLInternalFormat(GLenum internalFormat, CompressedFormat& format) {
+        const CompressedFormat all[] = { CompressedFormat::BC1, CompressedFormat::BC3,
+            CompressedFormat::ETC2_RGB, CompressedFormat::ETC2_RGBA };
+        for (CompressedFormat candidate : all) {
+            if (glInternalFormat(candidate) == internalFormat) {
+                format = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // BC1 for opaque images and BC3 for everything else; the ETC2 pair when etc is set
+    static CompressedFormat chooseFormat(const unsigned char* rgba, int width, int height, bool etc) {
+        size_t count = static_cast<size_t>(width) * height;
+        bool opaque = true;
+        for (size_t i = 0; i < count && opaque; ++i) opaque = rgba[i * 4 + 3] == 255;
+        if (etc) return opaque ? CompressedFormat::ETC2_RGB : CompressedFormat::ETC2_RGBA;
+        return opaque ? CompressedFormat::BC1 : CompressedFormat::BC3;
+    }
+
+    // Encodes level 0 and, with mipmaps, every level down to 1x1
+    static CompressedImage compress(const unsigned char* rgba, int width, int height, CompressedFormat format, bool mipmaps) {
+        CompressedImage image;
+        image.format = format;
+        image.width = width;
+        image.height = height;
+        image.levels.push_back(compressLevel(rgba, width, height, format));
+
+        std::vector<unsigned char> level;
+        const unsigned char* source = rgba;
+        while (mipmaps && (width > 1 || height > 1)) {
+            int nextWidth, nextHeight;
+            level = downsample(source, width, height, nextWidth, nextHeight);
+            width = nextWidth;
+            height = nextHeight;
+            source = level.data();
+            image.levels.push_back(compressLevel(source, width, height, format));
+        }
+        return image;
+    }
+
+    // RGBA8 texels of one level
+    static std::vector<unsigned char> decompress(const CompressedImage& image, size_t level, int& width, int& height) {
+        width = image.width;
+        height = image.height;
+        for (size_t i = 0; i < level; ++i) {
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        std::vector<unsigned char> rgba(static_cast<size_t>(width) * height * 4);
+        if (level >= image.levels.size() || image.levels[level].size() < levelBytes(image.format, width, height)) {
+            return rgba;
+        }
+
+        int blockSize = blockBytes(image.format);
+        int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        const unsigned char* data = image.levels[level].data();
+        uint8_t block[64];
+        for (int by = 0; by < blocksY; ++by) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                decodeBlock(image.format, data + (static_cast<size_t>(by) * blocksX + bx) * blockSize, block);
+                storeBlock(block, rgba.data(), width, height, bx * 4, by * 4);
+            }
+        }
+        return rgba;
+    }
+};
+
+const int TextureCompressor::etcModifiers[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+const int TextureCompressor::eacModifiers[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+#endif // TEXTURE_COMPRESS_H
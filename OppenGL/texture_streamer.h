@@ -0,0 +1,235 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "render_backend.h"
+#include "render_stats.h"
+#include "texture_cache.h"
+
+// Loads textures without stalling the frame that asks for them. acquire() returns a handle
+// right away that shows a placeholder; worker threads read and decode the file, and the
+// render thread uploads finished images in pump(), at most frameBudget bytes per frame.
+// An image larger than what is left of the budget goes in as bands of rows over the
+// following frames. Once uploaded, the handle's id() is the real texture; nothing holding
+// the handle has to change.
+//
+// acquire() and pump() run where GL calls are allowed, i.e. on the render thread.
+class TextureStreamer {
+private:
+    struct Request {
+        TextureEntry* entry;
+        std::string path;
+        TextureFilter filter;
+    };
+
+    struct Result {
+        TextureEntry* entry = nullptr;
+        bool ok = false;
+        DecodedTexture texture;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;       // workers: a request or stop
+    std::condition_variable decodedCv;  // finish(): a result arrived
+    std::deque<Request> requests;
+    std::deque<Result> results;
+    size_t decoding;                    // taken by a worker, no result yet
+    bool stopping;
+
+    // Bytes uploaded per pump(), about a 1024x1024 RGBA image
+    static const size_t frameBudget = 4 * 1024 * 1024;
+
+    unsigned int placeholderId;
+
+    // The image pump() is part way through (entry is null when there is none):
+    // its texture and the rows of it written so far
+    Result pending;
+    unsigned int pendingId;
+    int pendingRows;
+
+    TextureStreamer()
+        : decoding(0), stopping(false), placeholderId(0), pendingId(0), pendingRows(0) {
+        // Entries must outlive the workers that write into them
+        TextureCache::getInstance();
+    }
+
+    ~TextureStreamer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            requests.clear();
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    void startWorkers() {
+        // Leave a core each to the simulation and the render thread
+        unsigned int hardware = std::thread::hardware_concurrency();
+        unsigned int count = hardware > 3 ? std::min(hardware - 2, 4u) : 1u;
+        for (unsigned int i = 0; i < count; ++i) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stopping || !requests.empty(); });
+            if (stopping) return;
+
+            Request request = std::move(requests.front());
+            requests.pop_front();
+            ++decoding;
+            lock.unlock();
+
+            Result result;
+            result.entry = request.entry;
+            result.ok = TextureCache::decodeTexture(request.path, request.filter, result.texture);
+
+            lock.lock();
+            --decoding;
+            results.push_back(std::move(result));
+            decodedCv.notify_all();
+        }
+    }
+
+    // Mid grey at half alpha: visibly "not loaded yet" without flashing a bright colour
+    unsigned int placeholder() {
+        if (!placeholderId) {
+            const unsigned char pixels[4] = { 128, 128, 128, 128 };
+            TextureDesc desc;
+            desc.width = desc.height = 1;
+            desc.channels = 4;
+            desc.filter = TextureFilter::Nearest;
+            desc.mipmaps = false;
+            desc.clampToEdge = false;
+            placeholderId = RenderBackend::get().createTexture(desc, pixels);
+        }
+        return placeholderId;
+    }
+
+    // A texture that failed to decode or upload ends up with id 0, like a failed
+    // TextureCache::acquire; it must not keep the shared placeholder, which purgeUnused()
+    // would delete with it
+    void upload(Result& result) {
+        unsigned int id = result.ok ? TextureCache::uploadTexture(result.texture, true) : 0;
+        if (id) RenderStats::getInstance().recordUpload(result.texture.bytes());
+        publish(result, id);
+    }
+
+    void publish(Result& result, unsigned int id) {
+        TextureEntry* entry = result.entry;
+        if (id) {
+            entry->width = result.texture.desc.width;
+            entry->height = result.texture.desc.height;
+        }
+        entry->id = id;
+        entry->streaming = false;
+    }
+
+    // Uploads as much of the pending image as budget bytes allow and returns the bytes spent;
+    // the image stays pending until its last row is in. Cooked images have no row path:
+    // one larger than the budget waits for a frame of its own.
+    size_t uploadPending(size_t budget) {
+        if (!pending.ok) {
+            publish(pending, 0);
+            pending = Result();
+            return 0;
+        }
+
+        const DecodedTexture& texture = pending.texture;
+        size_t bytes = texture.bytes();
+        if (pendingRows == 0 && (bytes <= budget || texture.isCompressed)) {
+            if (texture.isCompressed && bytes > budget && budget < frameBudget) return 0;
+            upload(pending);
+            pending = Result();
+            return bytes;
+        }
+
+        const TextureDesc& desc = texture.desc;
+        size_t rowBytes = static_cast<size_t>(desc.width) * desc.channels;
+        int rows = static_cast<int>(std::min(budget / rowBytes, static_cast<size_t>(desc.height - pendingRows)));
+        if (rows == 0) return 0;
+
+        RenderBackend& backend = RenderBackend::get();
+        if (pendingRows == 0) pendingId = backend.createTexture(desc, nullptr);
+        backend.updateTextureRows(pendingId, desc, pendingRows, rows, texture.pixels.get() + pendingRows * rowBytes);
+        RenderStats::getInstance().recordUpload(rows * rowBytes);
+
+        pendingRows += rows;
+        if (pendingRows == desc.height) {
+            publish(pending, pendingId);
+            pending = Result();
+            pendingId = 0;
+            pendingRows = 0;
+        }
+        return rows * rowBytes;
+    }
+
+public:
+    static TextureStreamer& getInstance() {
+        static TextureStreamer instance;
+        return instance;
+    }
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Like TextureCache::acquire, but a texture that is not loaded yet is loaded in the background
+    TextureHandle acquire(const std::string& path, TextureFilter filter) {
+        TextureEntry* created = nullptr;
+        TextureHandle handle = TextureCache::getInstance().reserve(path, filter, placeholder(), created);
+        if (created) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (workers.empty()) startWorkers();
+            requests.push_back({ created, path, filter });
+            wake.notify_one();
+        }
+        return handle;
+    }
+
+    // Once per frame on the render thread: uploads decoded textures until the budget is spent
+    void pump() {
+        size_t spent = 0;
+        while (spent < frameBudget) {
+            if (!pending.entry) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (results.empty()) return;
+                pending = std::move(results.front());
+                results.pop_front();
+            }
+            spent += uploadPending(frameBudget - spent);
+            if (pending.entry) return;   // the rest of it next frame
+        }
+    }
+
+    // Waits for everything requested so far and uploads it, whatever the budget.
+    // For runs that have to show the same pixels every time (headless capture).
+    void finish() {
+        if (pending.entry) uploadPending(std::numeric_limits<size_t>::max());
+        std::deque<Result> ready;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                decodedCv.wait(lock, [this] { return !results.empty() || (requests.empty() && decoding == 0); });
+                if (results.empty()) return;
+                ready.swap(results);
+            }
+            for (Result& result : ready) upload(result);
+            ready.clear();
+        }
+    }
+};
+
+#endif // TEXTURE_STREAMER_H
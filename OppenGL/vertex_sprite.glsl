@@ -0,0 +1,35 @@
+#version 330 core
+layout (location = 0) in float aCorner;   // which corner of the outline, 0..7
+
+// Per-sprite instance attributes
+layout (location = 1) in vec4 aOffset;    // xy: centre, z: flags (1 screen space, 2 untextured)
+layout (location = 2) in vec4 aAxes;      // columns of the rotation/scale matrix
+layout (location = 3) in vec4 aTexRect;   // left u, top v, right u, bottom v
+layout (location = 4) in vec4 aColor;
+layout (location = 5) in vec4 aShape01;   // outline corners, 0..1 from the sprite's top-left,
+layout (location = 6) in vec4 aShape23;   // two per attribute; a whole frame is its four corners
+layout (location = 7) in vec4 aShape45;   // with every second one repeated
+layout (location = 8) in vec4 aShape67;
+
+// Camera: clip = world * viewProjection.xy + viewProjection.zw
+uniform vec4 viewProjection;
+
+out vec2 TexCoord;
+out vec4 ourColor;
+flat out int untextured;
+
+void main()
+{
+    int flags = int(aOffset.z);
+    int corner = int(aCorner);
+    vec4 pair = corner < 2 ? aShape01 : corner < 4 ? aShape23 : corner < 6 ? aShape45 : aShape67;
+    vec2 t = (corner & 1) == 0 ? pair.xy : pair.zw;
+
+    vec2 world = aOffset.xy + mat2(aAxes.xy, aAxes.zw) * vec2(t.x - 0.5, 0.5 - t.y);
+    if ((flags & 1) == 0)
+        world = world * viewProjection.xy + viewProjection.zw;
+    gl_Position = vec4(world, 0.0, 1.0);
+    TexCoord = mix(aTexRect.xy, aTexRect.zw, t);
+    ourColor = aColor;
+    untextured = flags & 2;
+}
\ No newline at end of file